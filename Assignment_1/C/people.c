@@ -0,0 +1,9341 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+
+#include "people.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+/**
+ * The size of one block handed from the file reader to the table scan
+ * and the number of blocks that can be in flight between them.
+ */
+#define STREAM_BLOCK_SIZE 65536
+#define STREAM_RING_SLOTS 8
+
+/**
+ * The number of reads of a plain file that io_uring keeps in flight ahead 
+ * of the table scan, and the alignment of the blocks so they can be read 
+ * with O_DIRECT. Must stay below STREAM_RING_SLOTS.
+ */
+#define STREAM_READS_IN_FLIGHT 4
+#define STREAM_ALIGNMENT 4096
+
+/**
+ * The compression formats recognized by `detect_compression`.
+ * Reading gzip needs the program to be built with -DHAVE_ZLIB -lz and
+ * reading zstd needs -DHAVE_ZSTD -lzstd.
+ */
+#define COMPRESSION_NONE 0
+#define COMPRESSION_GZIP 1
+#define COMPRESSION_ZSTD 2
+
+/**
+ * The flags of the columns of a people_model, used to build only the 
+ * columns a command needs.
+ */
+#define COLUMN_ID PEOPLE_COLUMN_ID
+#define COLUMN_NAME PEOPLE_COLUMN_NAME
+#define COLUMN_AGE PEOPLE_COLUMN_AGE
+#define COLUMN_WEIGHT PEOPLE_COLUMN_WEIGHT
+#define COLUMN_ALL PEOPLE_COLUMN_ALL
+#define COLUMN_TABLE PEOPLE_COLUMN_TABLE
+#define COLUMN_SKETCH PEOPLE_COLUMN_SKETCH
+
+/**
+ * The number of rows a lazy people_model decodes at once.
+ */
+#define MODEL_BLOCK_ROWS 4096
+
+/**
+ * The number of rows of a zone of the zone maps of a people_model.
+ * A multiple of MODEL_BLOCK_ROWS and of the 64 rows of a bitmap word.
+ */
+#define ZONE_ROWS 65536
+
+/**
+ * The number of rows below which a sort runs on one thread, and the 
+ * number of buckets of one pass of the radix sort (one byte of the key).
+ */
+#define SORT_PARALLEL_ROWS 65536
+#define SORT_RADIX 256
+
+/**
+ * The number of build rows above which a hash join is radix partitioned, so
+ * the hash table of each partition stays in the cache, and the number of 
+ * hash bits that then pick the partition.
+ */
+#define JOIN_PARTITION_ROWS 65536
+#define JOIN_PARTITION_BITS 6
+
+/**
+ * The number of hash bits that pick a register of a HyperLogLog sketch, its
+ * number of registers and the standard error of its estimates: 1.04 over 
+ * the square root of the number of registers.
+ */
+#define HLL_PRECISION 12
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define HLL_ERROR (1.04 / 64)
+
+/**
+ * The size of the top level of a KLL sketch and the rank error of its 
+ * quantiles with 99% confidence for that size, 2.296 / KLL_K^0.9723 as 
+ * given for KLL sketches by Apache DataSketches.
+ */
+#define KLL_K 200
+#define KLL_RANK_ERROR 0.0133
+
+/**
+ * The number of rows of the model sketched by one task.
+ */
+#define SKETCH_CHUNK_ROWS 65536
+
+/**
+ * The number of lines of output formatted by one task and the number of
+ * tasks whose lines are formatted before they are written out.
+ */
+#define RENDER_CHUNK_ROWS 4096
+#define RENDER_BATCH_CHUNKS 64
+
+/**
+ * The constants of the Arrow IPC file format written by `export_model_arrow`:
+ * the magic at both ends of the file, the marker before every message, the
+ * metadata version (V5), the message header and column types used, the 
+ * number of buffers of a record batch of the four columns, the index of
+ * the value buffers of age and weight among them, and the number of rows
+ * of a record batch.
+ */
+#define ARROW_MAGIC "ARROW1"
+#define ARROW_CONTINUATION 0xFFFFFFFFu
+#define ARROW_METADATA_V5 4
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_UTF8 5
+#define ARROW_BUFFER_COUNT 10
+#define ARROW_AGE_VALUES 7
+#define ARROW_WEIGHT_VALUES 9
+#define ARROW_BATCH_ROWS 65536
+
+/**
+ * The number of slots of the result cache of a dataset and the size of
+ * the buffer of the key of a mode.
+ */
+#define RESULT_CACHE_SLOTS 64
+#define RESULT_CACHE_KEY_SIZE 512
+
+/**
+ * The comparisons of a "where" clause and the most comparisons it can hold.
+ */
+#define FILTER_LESS 0
+#define FILTER_LESS_EQUAL 1
+#define FILTER_GREATER 2
+#define FILTER_GREATER_EQUAL 3
+#define FILTER_EQUAL 4
+#define FILTER_NOT_EQUAL 5
+#define FILTER_MAX_TERMS 16
+
+/**
+ * The operations of the "update" mode: `column += value`, `column -= value`
+ * and `column = value`.
+ */
+#define UPDATE_ADD 0
+#define UPDATE_SUBTRACT 1
+#define UPDATE_SET 2
+
+/**
+ * The number of frontier rows one task of a breadth first search over the
+ * relations expands, the distance of the rows it has not reached, and the
+ * largest number of relation types of an edge list.
+ */
+#define RELATION_CHUNK_ROWS 1024
+#define RELATION_UNSEEN 0xFFFFFFFFu
+#define RELATION_MAX_TYPES 65536
+#define RELATION_PENDING_LINES 16
+
+/**
+ * The relation modes found by `parse_relation_mode`.
+ */
+#define RELATION_MODE_NONE 0
+#define RELATION_MODE_LOAD 1
+#define RELATION_MODE_LIST 2
+#define RELATION_MODE_WITHIN 3
+#define RELATION_MODE_PATH 4
+
+/**
+ * What the zone map of a column tells of a comparison over one zone.
+ */
+#define FILTER_ZONE_NONE 0
+#define FILTER_ZONE_ALL 1
+#define FILTER_ZONE_SOME 2
+
+/**
+ * A structure that emulates a matrix of strings.
+ * Each cell is of a fixed width and any string shorter
+ * than the max width is trailed with nulls.
+ * 
+ * The column_count and row_count members help to 
+ * utilize the inter_padded_string as matrix.
+ * 
+ * All the members are pointer so they can be allocated in
+ * heap memory.
+ * 
+ * IMPORTANT: A string that uses the maximum width will not 
+ * have a termination null.
+*/
+typedef struct _string_mat {
+
+    char *inter_padded_strings;
+    unsigned long *cell_size;
+    unsigned long *column_count;
+    unsigned long *row_count;
+} string_mat;
+
+/**
+ * A structure that houses the information of a person.
+ * 
+ * All the members are pointers so they can point into the 
+ * columns of a people_model. See `model_get_person`.
+*/
+typedef struct _Person {
+
+    char *id;
+    char *name;
+    unsigned int *age;
+    unsigned int *weight;
+} Person;
+
+/**
+ * A deduplicated pool of strings that gives every distinct string a code.
+ * 
+ * The strings are stored one after the other, null terminated, in `pool`
+ * and the string of code c starts at pool[offsets[c]].
+ * `slots` is an open addressing hash table of code + 1, where 0 marks an
+ * empty slot. `slot_count` is a power of 2.
+*/
+typedef struct _string_dict {
+
+    char *pool;
+    unsigned long pool_size;
+    unsigned long pool_capacity;
+    unsigned long *offsets;
+    unsigned int count;
+    unsigned int capacity;
+    unsigned int *slots;
+    unsigned int slot_count;
+} string_dict;
+
+/**
+ * The zone map of a numeric column: the rows are split in zones of 
+ * ZONE_ROWS and zone z has the smallest and largest value of its rows, the
+ * number of its rows added so far and how many of them were empty cells.
+ * 
+ * Empty cells are stored as 0 in the column but are left out of the
+ * smallest and largest values, so a zone of only empty cells keeps a
+ * minimum larger than its maximum. `null_rows` marks them, 64 rows per word.
+*/
+typedef struct _zone_map {
+
+    unsigned int zone_count;
+    unsigned int *minimums;
+    unsigned int *maximums;
+    unsigned int *row_counts;
+    unsigned int *null_counts;
+    unsigned long *null_rows;
+} zone_map;
+
+/**
+ * A structure that houses the information of all the people of a table
+ * as columns: row i of every column belongs to the same person.
+ * 
+ * The id and name columns hold codes of their dictionaries so a repeated
+ * string is stored once and strings can be compared as integers.
+ * Only the columns in `column_mask` are built. The others are NULL.
+ * 
+ * A model with a source table is materialized lazily by `model_require`:
+ * the rows are split in blocks of MODEL_BLOCK_ROWS and block_columns[b]
+ * holds the COLUMN_ flags of the columns already decoded for block b.
+ * `complete_mask` holds the columns decoded for every row.
+ * 
+ * The zone maps of the age and weight columns are filled as their rows
+ * are parsed or decoded, see `zone_map_add`.
+*/
+typedef struct _people_model {
+
+    unsigned int count;
+    unsigned char column_mask;
+    unsigned char complete_mask;
+    char has_source;
+    string_mat source;
+    unsigned char *block_columns;
+    string_dict ids;
+    string_dict names;
+    unsigned int *id_codes;
+    unsigned int *name_codes;
+    unsigned int *ages;
+    unsigned int *weights;
+    zone_map age_zones;
+    zone_map weight_zones;
+} people_model;
+
+/**
+ * A structure that holds the state of the first reading pass over a string of
+ * comma separated values, so the pass can be run over a string that arrives
+ * in blocks. The pass finds the number of rows and columns and the largest
+ * cell size, which `build_table_from_scan` needs to build the table.
+*/
+typedef struct _table_scan {
+
+    unsigned int comma_count;
+    unsigned int current_comma_count;
+    unsigned int largest_cell;
+    unsigned int current_largest_cell;
+    unsigned int row_count;
+    char last_char;
+} table_scan;
+
+/**
+ * A fixed-size block of a file's contents and the number of chars used in it.
+*/
+typedef struct _stream_block {
+
+    char *data;
+    unsigned long length;
+} stream_block;
+
+/**
+ * A bounded ring of blocks passed from a producer thread that reads the file
+ * to the consumer that scans it.
+ * 
+ * The producer fills the block at `tail` and the consumer reads the block 
+ * at `head`. `filled` counts the published blocks not yet consumed.
+*/
+typedef struct _block_ring {
+
+    stream_block slots[STREAM_RING_SLOTS];
+    unsigned int head;
+    unsigned int tail;
+    unsigned int filled;
+    char finished;
+    char failed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} block_ring;
+
+/**
+ * The arguments of the producer thread.
+ * Plain regular files are read by offset from `descriptor`, the file 
+ * descriptor of `input_file`, and `file_size` is their size. It is -1 for
+ * files that can only be read in order, like pipes.
+*/
+typedef struct _stream_job {
+
+    FILE *input_file;
+    char compression;
+    block_ring *ring;
+    int descriptor;
+    long file_size;
+} stream_job;
+
+#ifdef HAVE_IO_URING
+/**
+ * An io_uring instance set up with raw system calls: its file descriptor
+ * and the submission and completion rings shared with the kernel.
+ * The sizes are kept to unmap the rings.
+*/
+typedef struct _uring_reader {
+
+    int ring_descriptor;
+    void *submission_ring;
+    void *completion_ring;
+    unsigned long submission_ring_size;
+    unsigned long completion_ring_size;
+    unsigned int *submission_tail;
+    unsigned int *submission_mask;
+    unsigned int *submission_array;
+    struct io_uring_sqe *entries;
+    unsigned long entries_size;
+    unsigned int *completion_head;
+    unsigned int *completion_tail;
+    unsigned int *completion_mask;
+    struct io_uring_cqe *completions;
+} uring_reader;
+#endif
+
+/**
+ * A growing string that the blocks of a file are appended to, and the table
+ * scan that runs over them. See `append_block`.
+*/
+typedef struct _string_builder {
+
+    char *string;
+    unsigned long length;
+    unsigned long capacity;
+    table_scan *scan;
+} string_builder;
+
+/**
+ * A HyperLogLog sketch of the number of distinct values of a column.
+ * Each value is hashed to 64 bits: the top HLL_PRECISION bits pick a 
+ * register and the register keeps the longest run of leading zeros seen
+ * in the other bits. Two sketches are merged by taking the larger register.
+*/
+typedef struct _hll_sketch {
+
+    unsigned char registers[HLL_REGISTERS];
+} hll_sketch;
+
+/**
+ * A KLL sketch of the quantiles of a column.
+ * 
+ * `levels[h]` holds `level_sizes[h]` sampled values that each stand for 
+ * 2^h values of the column. When a level is full it is sorted and every 
+ * other value, from a random start, moves up a level, so the sketch keeps 
+ * about 3 * KLL_K values however many are added. Two sketches are merged by
+ * joining their levels and compacting again.
+ * `compacted` is 0 while the sketch still holds every value, when its 
+ * quantiles are exact.
+*/
+typedef struct _kll_sketch {
+
+    unsigned long count;
+    unsigned int level_count;
+    unsigned int *level_sizes;
+    unsigned int *level_capacities;
+    unsigned int **levels;
+    unsigned long random_state;
+    char compacted;
+} kll_sketch;
+
+/**
+ * The sketches of the columns of a dataset: a HyperLogLog sketch for each
+ * column of `column_mask`, by column index, and a KLL sketch for the ages
+ * and the weights if they are in the mask.
+*/
+typedef struct _people_sketches {
+
+    unsigned char column_mask;
+    unsigned long count;
+    hll_sketch distinct[4];
+    kll_sketch ages;
+    kll_sketch weights;
+} people_sketches;
+
+/**
+ * The start of a line that was cut by the end of a block of a file, kept
+ * by `split_block_lines` until the next block completes it.
+*/
+typedef struct _line_carry {
+
+    char *text;
+    unsigned long length;
+    unsigned long capacity;
+} line_carry;
+
+/**
+ * The state of `build_model_projected` between two blocks of the file.
+ * 
+ * `capacity` is the number of people the columns of the model have room for.
+ * If `sketches` is not NULL the rows go to the sketches instead of the model.
+*/
+typedef struct _projection_parser {
+
+    people_model *model;
+    people_sketches *sketches;
+    unsigned int capacity;
+    char header_done;
+    char corrupt;
+    line_carry carry;
+} projection_parser;
+
+/**
+ * The range of task indices still waiting in one worker's queue.
+ * The owner takes tasks from `begin` and idle workers steal from `end`.
+*/
+typedef struct _task_range {
+
+    unsigned int begin;
+    unsigned int end;
+    pthread_mutex_t lock;
+} task_range;
+
+/**
+ * A work-stealing pool that runs `task(context, index)` once for every
+ * index below a task count. See `run_parallel_tasks`.
+*/
+typedef struct _task_pool {
+
+    task_range *ranges;
+    unsigned int worker_count;
+    void (*task)(void *context, unsigned int index);
+    void *context;
+} task_pool;
+
+/**
+ * The arguments of one worker thread of a task pool. `started` is set once
+ * its thread is created.
+*/
+typedef struct _task_worker {
+
+    task_pool *pool;
+    unsigned int worker_index;
+    char started;
+} task_worker;
+
+/**
+ * The partial aggregates of one shard, or the merged aggregates of several.
+ * Sums are kept instead of averages so aggregates can be merged exactly.
+*/
+typedef struct _shard_aggregate {
+
+    unsigned long count;
+    unsigned long age_sum;
+    unsigned int age_min;
+    unsigned int age_max;
+    unsigned long weight_sum;
+    unsigned int weight_min;
+    unsigned int weight_max;
+} shard_aggregate;
+
+/**
+ * One file of a sharded dataset.
+ * 
+ * `size`, `mtime` and `mtime_nanoseconds` identify the version of the file
+ * the aggregate belongs to. A shard whose aggregate came from the shard cache is `cached` and its
+ * rows are only loaded if a command needs them.
+*/
+typedef struct _shard {
+
+    char *path;
+    unsigned long size;
+    long mtime;
+    long mtime_nanoseconds;
+    char cached;
+    char loaded;
+    char failed;
+    string_mat table;
+    people_model model;
+    shard_aggregate aggregate;
+} shard;
+
+/**
+ * All the shards of a dataset, as passed to the shard loading tasks.
+*/
+typedef struct _shard_set {
+
+    shard *shards;
+    unsigned int count;
+    char need_rows;
+    char *search_id;
+    int *search_results;
+} shard_set;
+
+/**
+ * The shared state of the sketching of a sharded dataset: the sketches of
+ * each shard, built in parallel and merged in the order of the shards.
+*/
+typedef struct _shard_sketch_job {
+
+    shard_set *set;
+    unsigned char column_mask;
+    people_sketches *shard_sketches;
+} shard_sketch_job;
+
+/**
+ * An index over the name column of the model, built on first use by
+ * `name_index_build`. Names are compared without regard to case.
+ * `count` is the number of rows of the model.
+ * 
+ * `sorted_rows` holds the model rows ordered by name for prefix queries.
+ * The trigram part maps every 3 character sequence of the names to the 
+ * sorted rows that contain it: the rows of trigram_keys[i] are 
+ * posting_rows[posting_offsets[i]] to posting_rows[posting_offsets[i + 1] - 1].
+*/
+typedef struct _name_index {
+
+    char built;
+    people_model *model;
+    unsigned int count;
+    unsigned int *sorted_rows;
+    unsigned int trigram_count;
+    unsigned int *trigram_keys;
+    unsigned int *posting_offsets;
+    unsigned int *posting_rows;
+} name_index;
+
+/**
+ * One distinct string of a dictionary while it is sorted: its code and its
+ * first 8 bytes, most significant first, so most comparisons never read the
+ * string itself.
+*/
+typedef struct _sort_entry {
+
+    unsigned long prefix;
+    unsigned int code;
+} sort_entry;
+
+/**
+ * The shared state of a parallel sort. The items are split in 
+ * `chunk_count` contiguous chunks and each task works on one chunk.
+ * 
+ * The radix sort orders `rows` by `keys[row]`, one byte at `shift` per pass.
+ * `histograms[chunk * SORT_RADIX + digit]` first counts the keys of a chunk
+ * with a digit and then holds where the chunk writes the next one.
+ * 
+ * The merge sort orders `entries` by the strings of `dict`. `width` is the
+ * number of chunks already merged into each run.
+*/
+typedef struct _sort_job {
+
+    unsigned int count;
+    unsigned int chunk_count;
+    unsigned int *keys;
+    unsigned int flip;
+    unsigned int shift;
+    unsigned int *rows;
+    unsigned int *sorted_rows;
+    unsigned long *histograms;
+    string_dict *dict;
+    sort_entry *entries;
+    sort_entry *merged_entries;
+    unsigned int width;
+} sort_job;
+
+/**
+ * One side of a hash join: a table, the column of its key and the hash of 
+ * the key of each data row. `partition_rows` holds the data rows grouped
+ * by partition and `partition_offsets[p]` is where partition p starts in it.
+*/
+typedef struct _join_side {
+
+    string_mat table;
+    unsigned int key_column;
+    unsigned int count;
+    unsigned int *hashes;
+    unsigned int *partition_rows;
+    unsigned int *partition_offsets;
+} join_side;
+
+/**
+ * The shared state of a hash join. `build` is the side put in the hash 
+ * tables and `probe` the side looked up in them. `matches[p]` holds the 
+ * pairs of partition p, left row then right row, and `match_counts[p]` 
+ * their number.
+*/
+typedef struct _join_job {
+
+    join_side *build;
+    join_side *probe;
+    char build_is_left;
+    unsigned int partition_bits;
+    unsigned int **matches;
+    unsigned int *match_counts;
+} join_job;
+
+/**
+ * The pairs of data rows of two tables with equal keys: `left_rows[i]` 
+ * and `right_rows[i]`, where 0 is the row after the header.
+*/
+typedef struct _join_result {
+
+    unsigned int count;
+    unsigned int *left_rows;
+    unsigned int *right_rows;
+} join_result;
+
+/**
+ * One comparison of a filter: `column operation value`, for example 
+ * "age > 40". `or_before` is 1 if the comparison is joined to the one
+ * before it with "or" and 0 if with "and" (or if it is the first).
+*/
+typedef struct _filter_term {
+
+    unsigned char column;
+    unsigned char operation;
+    unsigned int value;
+    char or_before;
+} filter_term;
+
+/**
+ * A parsed "where" clause: comparisons joined by "and" and "or", where 
+ * "and" binds tighter. `column_mask` holds the COLUMN_ flags it reads.
+*/
+typedef struct _row_filter {
+
+    unsigned int term_count;
+    filter_term terms[FILTER_MAX_TERMS];
+    unsigned char column_mask;
+} row_filter;
+
+/**
+ * A parsed "update" mode: `column operation operand` for the rows whose bit
+ * is set in `selected`, 64 rows per word. `mode` is a copy of the mode and
+ * `clause` points at its "where" clause, or is NULL to update every row.
+*/
+typedef struct _column_update {
+
+    unsigned char column;
+    unsigned char operation;
+    unsigned int operand;
+    char mode[261];
+    char *clause;
+    unsigned long *selected;
+    unsigned int selected_count;
+} column_update;
+
+/**
+ * The relations between the people of a model as a compressed sparse row
+ * adjacency over the rows of the model: the relations of row r are the 
+ * entries offsets[r] to offsets[r + 1] - 1 of `targets`, the rows they lead
+ * to, and of `types`, the codes of their names in `relation_types`.
+ * Each line of the edge list is kept in both directions.
+*/
+typedef struct _relation_graph {
+
+    unsigned int vertex_count;
+    unsigned long edge_count;
+    unsigned long *offsets;
+    unsigned int *targets;
+    unsigned short *types;
+    string_dict relation_types;
+} relation_graph;
+
+/**
+ * One line of an edge list: the rows of its two people and the codes of
+ * the relation of the first to the second and of the second to the first.
+*/
+typedef struct _edge_line {
+
+    unsigned int first;
+    unsigned int second;
+    unsigned short relation;
+    unsigned short back_relation;
+} edge_line;
+
+/**
+ * A line of an edge list whose ids are not yet looked up: the ids and the
+ * relations point into the block being parsed and the hash table slots of
+ * the hashes of the ids are being prefetched.
+*/
+typedef struct _pending_edge {
+
+    char *ids[2];
+    unsigned int id_lengths[2];
+    unsigned int hashes[2];
+    char *relations[2];
+    unsigned int relation_lengths[2];
+} pending_edge;
+
+/**
+ * The state of `build_relation_graph` between two blocks of the edge list.
+ * 
+ * `code_rows` holds the first row of each code of the id dictionary of the
+ * model. The lines read so far are kept in `lines`, with room for 
+ * `capacity`, while the degree of each row is counted in the offsets of 
+ * the graph. `skipped_count` counts the lines that name an unknown id.
+ * The last lines of the block are kept in the `pending` ring, from
+ * `pending_first`, until their ids are looked up.
+*/
+typedef struct _edge_parser {
+
+    people_model *model;
+    relation_graph *graph;
+    unsigned int *code_rows;
+    edge_line *lines;
+    unsigned long count;
+    unsigned long capacity;
+    unsigned long skipped_count;
+    char header_done;
+    char corrupt;
+    line_carry carry;
+    pending_edge pending[RELATION_PENDING_LINES];
+    unsigned int pending_first;
+    unsigned int pending_count;
+} edge_parser;
+
+/**
+ * One depth of a breadth first search over a relation graph, shared by 
+ * the tasks of `expand_frontier_task`: the rows of the frontier, the 
+ * distance and the parent of every row, and the rows each chunk of the
+ * frontier reached at `depth`. `failed` is set when a task could not keep
+ * the rows it reached, which ends the search.
+*/
+typedef struct _frontier_job {
+
+    relation_graph *graph;
+    unsigned int *frontier;
+    unsigned int frontier_count;
+    unsigned int depth;
+    unsigned int *distances;
+    unsigned int *parents;
+    unsigned int **found;
+    unsigned int *found_counts;
+    char failed;
+} frontier_job;
+
+/**
+ * The reached rows of a relation search and their distances, formatted by
+ * `render_reached_person`.
+*/
+typedef struct _reached_render {
+
+    people_model *model;
+    unsigned int *rows;
+    unsigned int *distances;
+} reached_render;
+
+/**
+ * A flatbuffer built front to back, for the metadata of Arrow files: 
+ * objects are appended after the objects that refer to them, so every
+ * offset points forward. `failed` is set if the data could not grow.
+*/
+typedef struct _flat_builder {
+
+    unsigned char *data;
+    unsigned long length;
+    unsigned long capacity;
+    char failed;
+} flat_builder;
+
+/**
+ * The results of a mode kept by a result cache: the key of the mode (see
+ * `normalize_command`), the generation of the dataset they were computed
+ * from, and the value and the number of rows, or the row, of the mode.
+*/
+typedef struct _cached_result {
+
+    char *command;
+    unsigned long generation;
+    double value;
+    long count;
+} cached_result;
+
+/**
+ * The results of the aggregate, count and id lookup modes of a dataset,
+ * in slots picked by the hash of their key. `generation` is the generation
+ * of the dataset the cache is used with: results of older generations 
+ * are stale. `hits` and `misses` count the lookups.
+*/
+typedef struct _result_cache {
+
+    cached_result slots[RESULT_CACHE_SLOTS];
+    unsigned long generation;
+    unsigned long hits;
+    unsigned long misses;
+} result_cache;
+
+/**
+ * The structure behind the people_dataset handle of people.h.
+ * 
+ * A dataset opened from one file or buffer holds its table and a lazy
+ * model over it, or only a projected model if it was opened with 
+ * `people_open_columns`. A dataset opened from shards holds the shard set
+ * and the merged aggregates. `shard_offsets[i]` is the row of the dataset
+ * where the rows of shard i start, once the rows of the shards are loaded.
+ * `sketches` are built the first time a sketch mode needs them, or while
+ * parsing for a dataset opened with COLUMN_SKETCH, which only holds them.
+ * `selected_rows` are the rows of the last `people_select`.
+ * `path` and `column_mask` are how the dataset was opened, for 
+ * `people_reload`; `path` is NULL for a buffer. The generation of `cache`
+ * is the generation of the data, bumped by every reload, so the cache 
+ * never answers with results of older data. `relations` are loaded from
+ * the edge list at `relations_path`, and loaded again by every reload.
+*/
+struct _people_dataset {
+
+    char *text;
+    char has_table;
+    string_mat table;
+    people_model model;
+    name_index names;
+    char is_sharded;
+    shard_set set;
+    shard_aggregate total;
+    unsigned int cached_count;
+    unsigned long *shard_offsets;
+    unsigned int *sorted_rows;
+    people_sketches *sketches;
+    unsigned int *selected_rows;
+    char *path;
+    unsigned int column_mask;
+    result_cache cache;
+    relation_graph *relations;
+    char *relations_path;
+};
+
+/**
+ * A helper function to handle the allocation of the unsigned int type.
+ * 
+ * Can be used to allocate an unsigned int in heap or to create an array
+ * of unsigned int.
+ * 
+ * As of now, if the memory is not sufficient, the pointer will be lost.
+ * This behaviour will be changed.
+ * 
+ * args:
+ *  - size: the the number of unsigned int's to allocate.
+ * 
+ * return:
+ *  - unsigned int pointer to the location in heap.
+ */
+static unsigned int *allocate_unsigned_int(unsigned int size) {
+
+    unsigned int *return_unsigned_int = malloc(sizeof(unsigned int) * size);
+    if (return_unsigned_int == NULL) {
+        printf("Allocation fail [0]: returning NULL.");
+    }
+    return return_unsigned_int;
+}
+
+/**
+ * A helper function to handle the allocation of a string.
+ * Can be used to allocate a string in heap or to create an array
+ * of float.
+ * 
+ * If the memory is not sufficient, an null character will be returned.
+ * 
+ * args:
+ *  - size: the the number of chars to allocate.
+ * 
+ * return:
+ *  - char pointer to the location in heap.
+ */
+static char *allocate_string(unsigned int size) {
+
+    char *return_string = malloc(sizeof(char) * (size + 1));
+    if (return_string == NULL) {
+        printf("Allocation fail [1]: returning empty string.");
+        return "";
+    }
+    return_string[size] = '\0';
+    return return_string;
+}
+
+/**
+ * Reallocates a string to a new size.
+ * The new size can be less than or more than the old size.
+ * 
+ * If the memory is not sufficient, the old string is returned.
+ * 
+ * args:
+ *  - target_string: the string pointer to be reallocated.
+ *  - new_size: the number of characters in the new string.
+ *              must include the termination char.
+ * return:
+ *  - char pointer to the location in heap.
+ */
+static char *reallocate_string(
+    char *target_string,
+    unsigned int new_size) {
+    char *return_string = realloc(target_string, new_size);
+    if (return_string == NULL) {
+        printf("Allocation fail [2]: returning original string.");
+        return target_string;
+    }
+    return return_string;
+}
+
+/**
+ * Given a string determine its length.
+ * 
+ * args:
+ *  - target_string: the string to be examined.
+ * 
+ * return:
+ *  - the character count to and including the nearest null char.
+ */
+static unsigned int string_length(char *target_string) {
+
+    unsigned int length = 0;
+    char current_char;
+    do {
+        current_char = target_string[length++];
+    } while (current_char != '\0');
+    return length - 1;
+}
+
+/**
+ * Given a string and a prefix, find if the string starts with the prefix.
+ * 
+ * args:
+ *  - target_string: the string to examine.
+ *  - prefix: the prefix to look for.
+ * 
+ * return:
+ *  - returns 1 if target_string starts with prefix and 0 if not.
+ */
+static char string_starts_with(char *target_string, char *prefix) {
+    for (unsigned int index = 0; prefix[index] != '\0'; ++index) {
+        if (target_string[index] != prefix[index]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Given a target string, a reference string, and their length, copy contents of
+ * reference_string into target_string.
+ * 
+ * IMPORTANT: both strings should have the same length as the copying will not 
+ * stop even if a null char is encountered.
+ * 
+ * args:
+ *  - target_string: the string to be copied into.
+ *  - reference_string: the string from which to copy.
+ *  - count: the number of characters to copy.
+ *  - starting_index: the position in reference_string from which copying begins.
+ * 
+ * return:
+ *  - the same pointer to target_string
+ */
+static char *string_simple_copy(
+    char *target_string,
+    char *reference_string,
+    unsigned int length) {
+    for (int i = 0; i < length; ++i) {
+        target_string[i] = reference_string[i];
+    }
+    return target_string;
+}
+
+/**
+ * Given a string matrix, a row and a column indicies, find the absolute order of the string
+ * referenced by the row and column indicies.
+ * 
+ * An element with row index of i and column index of j in a table of width n will have 
+ * an absolute index of I = i * n + j.
+ * 
+ * Accounting for cell size c: I = (i * n + j) * c.
+ * 
+ * args:
+ *  - table: the table. To get the width n and cell size c.
+ *  - row: the row index i.
+ *  - column: the column index j.
+ * 
+ * return:
+ *  - the absolute index I.
+ */
+static unsigned int string_mat_get_absolute_index(
+    string_mat table,
+    unsigned int row,
+    unsigned int column) {
+    unsigned int return_unsigned_int =
+        (row * table.cell_size[0] * table.column_count[0]) +
+        (table.cell_size[0] * column);
+    return return_unsigned_int;
+}
+
+/**
+ * Given a table scan and a chunk of a string with comma separated values, 
+ * continue the first reading pass over the chunk.
+ * 
+ * The chunk does not need to end on a row boundary, so the function can be 
+ * fed the blocks of a file as they arrive and the counting overlaps the reading.
+ * Empty lines are not counted as rows.
+ * 
+ * args:
+ *  - scan: the scan state to update.
+ *  - chunk: the characters to scan.
+ *  - length: the number of characters in chunk.
+ */
+static void table_scan_chunk(
+    table_scan *scan,
+    char *chunk,
+    unsigned long length) {
+
+    for (unsigned long index = 0; index < length; ++index) {
+        switch (chunk[index]) {
+            case ',':
+                ++scan->current_comma_count;
+                if (scan->current_largest_cell > scan->largest_cell) {
+                    scan->largest_cell = scan->current_largest_cell;
+                }
+                scan->current_largest_cell = 0;
+                scan->last_char = ',';
+                break;
+
+            case '\n':
+                if (scan->last_char == '\n') {
+                    break;
+                }
+                if (scan->current_largest_cell > scan->largest_cell) {
+                    scan->largest_cell = scan->current_largest_cell;
+                }
+                scan->current_largest_cell = 0;
+                ++scan->row_count;
+                if (scan->current_comma_count > scan->comma_count) {
+                    scan->comma_count = scan->current_comma_count;
+                }
+                scan->current_comma_count = 0;
+                scan->last_char = '\n';
+                break;
+
+            default:
+                ++scan->current_largest_cell;
+                scan->last_char = 1;
+                break;
+        }
+    }
+}
+
+/**
+ * Given a table scan, return it to its starting state.
+ * 
+ * args:
+ *  - scan: the scan state to reset.
+ */
+static void table_scan_init(table_scan *scan) {
+    scan->comma_count = 0;
+    scan->current_comma_count = 0;
+    scan->largest_cell = 0;
+    scan->current_largest_cell = 0;
+    scan->row_count = 0;
+    scan->last_char = '\n';
+}
+
+/**
+ * Given a table scan that has seen the whole string, account for a last row 
+ * that is not followed by a new line.
+ * 
+ * args:
+ *  - scan: the scan state to finish.
+ */
+static void table_scan_finish(table_scan *scan) {
+    if (scan->last_char != '\n') {
+        table_scan_chunk(scan, "\n", 1);
+    }
+}
+
+/**
+ * Given a string that contains comma separated values and the result of the
+ * first reading pass over it, build a string matrix containing the data.
+ * 
+ * The string is read a second time to build the matrix and pad all the values
+ * will null chars as to have the size of the largest value.
+ * 
+ * 
+ * args:
+ *  - raw_string: the string with comma separated values.
+ *  - scan: the finished table scan of raw_string.
+ * 
+ * return:
+ *  - a string matrix with the data, or without rows if its padded cells do
+ *    not fit in memory.
+ */
+static string_mat build_table_from_scan(char *raw_string, table_scan scan) {
+    string_mat table;
+
+    unsigned int largest_cell = scan.largest_cell;
+    unsigned int comma_count = scan.comma_count;
+    unsigned int row_count = scan.row_count;
+
+    unsigned long raw_string_index = 0;
+    char last_char;
+    char previous_char = '\n';
+
+    char while_exit_flag = 0;
+
+    unsigned long cell_count = (unsigned long)row_count * (comma_count + 1UL);
+    table.inter_padded_strings = NULL;
+    if (largest_cell == 0 || cell_count <= (unsigned long)-1 / largest_cell) {
+        table.inter_padded_strings = calloc(cell_count * largest_cell + 1, sizeof(char));
+    }
+    table.column_count = malloc(sizeof(unsigned long));
+    table.row_count = malloc(sizeof(unsigned long));
+    table.cell_size = malloc(sizeof(unsigned long));
+
+    table.cell_size[0] = largest_cell;
+    table.column_count[0] = comma_count + 1;
+    table.row_count[0] = row_count;
+    if (table.inter_padded_strings == NULL) {
+        printf("Allocation fail [3]: the padded cells of the table do not fit in memory.");
+        table.row_count[0] = 0;
+        return table;
+    }
+
+    unsigned long cells_left = largest_cell;
+    unsigned long index = 0;
+    while (1) {
+        if (while_exit_flag) {
+            break;
+        }
+        last_char = raw_string[raw_string_index++];
+        switch (last_char) {
+            case ',':
+                for (; cells_left > 0; --cells_left) {
+                    table.inter_padded_strings[index++] = '\0';
+                }
+                cells_left = largest_cell;
+                break;
+
+            case '\n':
+                if (previous_char == '\n') {
+                    break;
+                }
+                for (; cells_left > 0; --cells_left) {
+                    table.inter_padded_strings[index++] = '\0';
+                }
+                cells_left = largest_cell;
+                break;
+
+            case '\0':
+                while_exit_flag = 1;
+                break;
+
+            default:
+                table.inter_padded_strings[index++] = last_char;
+                --cells_left;
+                break;
+        }
+        previous_char = last_char;
+    }
+    return table;
+}
+
+/**
+ * Given a string matrix, validate that it has at least 2 rows and that it has at 
+ * `column_count` number of columns.
+ * 
+ * 
+ * args:
+ *  - table: the table to be validated.
+ *  - column_count: the number of columns that should be in the table.
+ * 
+ * return:
+ *  - returns 1 if the table passes validation and 0 if it does not.
+ */
+static char validate_table(
+    string_mat table,
+    unsigned int column_count) {
+    if (table.row_count[0] > 2 && table.column_count[0] == column_count) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Given a string and its length, compute its FNV-1a hash.
+ * 
+ * args:
+ *  - target_string: the string to hash.
+ *  - length: the number of characters to hash.
+ * 
+ * return:
+ *  - the 32 bit hash.
+ */
+static unsigned int string_hash(char *target_string, unsigned int length) {
+    unsigned int hash = 2166136261u;
+    for (unsigned int index = 0; index < length; ++index) {
+        hash ^= (unsigned char)target_string[index];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Given a string dictionary, make it an empty dictionary.
+ * 
+ * args:
+ *  - dict: the dictionary to initialize.
+ */
+static void string_dict_init(string_dict *dict) {
+    dict->pool_size = 0;
+    dict->pool_capacity = 1024;
+    dict->pool = malloc(sizeof(char) * dict->pool_capacity);
+    dict->count = 0;
+    dict->capacity = 64;
+    dict->offsets = malloc(sizeof(unsigned long) * dict->capacity);
+    dict->slot_count = 128;
+    dict->slots = calloc(dict->slot_count, sizeof(unsigned int));
+    if (dict->pool == NULL || dict->offsets == NULL || dict->slots == NULL) {
+        printf("Allocation fail [7]: could not allocate a string dictionary.");
+    }
+}
+
+/**
+ * Given a string dictionary, find the hash table slot of a string: the slot
+ * that holds its code, or the empty slot where its code would go.
+ * 
+ * args:
+ *  - dict: the dictionary to search.
+ *  - target_string: the string to search for.
+ *  - length: the length of target_string.
+ *  - hash: the string_hash of target_string.
+ * 
+ * return:
+ *  - the index of the slot.
+ */
+static unsigned int string_dict_find_slot(
+    string_dict *dict,
+    char *target_string,
+    unsigned int length,
+    unsigned int hash) {
+
+    unsigned int slot = hash & (dict->slot_count - 1);
+    while (dict->slots[slot] != 0) {
+        char *entry = dict->pool + dict->offsets[dict->slots[slot] - 1];
+        unsigned int index = 0;
+        while (index < length && entry[index] == target_string[index]) {
+            ++index;
+        }
+        if (index == length && entry[length] == '\0') {
+            return slot;
+        }
+        slot = (slot + 1) & (dict->slot_count - 1);
+    }
+    return slot;
+}
+
+/**
+ * Given a string dictionary, a string and its length, return the code of the
+ * string, adding it to the dictionary if it is not there yet.
+ * The string does not need to be null terminated.
+ * 
+ * args:
+ *  - dict: the dictionary to intern into.
+ *  - target_string: the string to intern.
+ *  - length: the length of target_string.
+ * 
+ * return:
+ *  - the code of the string. Codes are given out in order from 0.
+ *  - -1 if the dictionary could not grow. It is left as it was.
+ */
+static int string_dict_intern(
+    string_dict *dict,
+    char *target_string,
+    unsigned int length) {
+
+    unsigned int hash = string_hash(target_string, length);
+    unsigned int slot = string_dict_find_slot(dict, target_string, length, hash);
+    if (dict->slots[slot] != 0) {
+        return dict->slots[slot] - 1;
+    }
+
+    if ((dict->count + 1) * 2 > dict->slot_count) {
+        unsigned int *slots = calloc(dict->slot_count * 2, sizeof(unsigned int));
+        if (slots == NULL) {
+            goto after_allocation_fail;
+        }
+        free(dict->slots);
+        dict->slots = slots;
+        dict->slot_count *= 2;
+        for (unsigned int code = 0; code < dict->count; ++code) {
+            char *entry = dict->pool + dict->offsets[code];
+            unsigned int entry_length = string_length(entry);
+            dict->slots[string_dict_find_slot(
+                dict, entry, entry_length, string_hash(entry, entry_length))] = code + 1;
+        }
+        slot = string_dict_find_slot(dict, target_string, length, hash);
+    }
+    if (dict->pool_size + length + 1 > dict->pool_capacity) {
+        unsigned long pool_capacity = dict->pool_capacity;
+        while (dict->pool_size + length + 1 > pool_capacity) {
+            pool_capacity *= 2;
+        }
+        char *pool = realloc(dict->pool, sizeof(char) * pool_capacity);
+        if (pool == NULL) {
+            goto after_allocation_fail;
+        }
+        dict->pool = pool;
+        dict->pool_capacity = pool_capacity;
+    }
+    if (dict->count == dict->capacity) {
+        unsigned long *offsets =
+            realloc(dict->offsets, sizeof(unsigned long) * dict->capacity * 2);
+        if (offsets == NULL) {
+            goto after_allocation_fail;
+        }
+        dict->offsets = offsets;
+        dict->capacity *= 2;
+    }
+    dict->offsets[dict->count] = dict->pool_size;
+    string_simple_copy(dict->pool + dict->pool_size, target_string, length);
+    dict->pool[dict->pool_size + length] = '\0';
+    dict->pool_size += length + 1;
+    dict->slots[slot] = ++dict->count;
+    return dict->count - 1;
+
+after_allocation_fail:
+    printf("Allocation fail [7]: could not grow a string dictionary.");
+    return -1;
+}
+
+/**
+ * Given a string dictionary, a string and its length, find the code of the
+ * string without adding it. The string does not need to be null terminated.
+ * 
+ * return:
+ *  - the code of the string, or -1 if it is not in the dictionary.
+ */
+static int string_dict_find(string_dict *dict, char *target_string, unsigned int length) {
+    unsigned int slot = string_dict_find_slot(
+        dict, target_string, length, string_hash(target_string, length));
+    return (int)dict->slots[slot] - 1;
+}
+
+/**
+ * Given a string dictionary and a null terminated string, find the code of
+ * the string without adding it.
+ * 
+ * args:
+ *  - dict: the dictionary to search.
+ *  - target_string: the string to search for.
+ * 
+ * return:
+ *  - the code of the string, or -1 if it is not in the dictionary.
+ */
+static int string_dict_lookup(string_dict *dict, char *target_string) {
+    return string_dict_find(dict, target_string, string_length(target_string));
+}
+
+/**
+ * Given a string dictionary and a code, return the string of the code.
+ * The pointer is valid until the next string is interned.
+ */
+static char *string_dict_get(string_dict *dict, unsigned int code) {
+    return dict->pool + dict->offsets[code];
+}
+
+/**
+ * Given a string dictionary, deallocate memory for all of its members.
+ * 
+ * args:
+ *  - dict: the dictionary to deallocate members of.
+ */
+static void deallocate_string_dict(string_dict *dict) {
+    free(dict->pool);
+    free(dict->offsets);
+    free(dict->slots);
+}
+
+/**
+ * Given a cell of the string matrix, find the length of its string.
+ * A string that uses the whole cell has no terminating null.
+ * 
+ * args:
+ *  - cell: the first char of the cell.
+ *  - cell_size: the size of the cells of the matrix.
+ * 
+ * return:
+ *  - the number of chars before the first null char or the end of the cell.
+ */
+static unsigned int cell_length(char *cell, unsigned int cell_size) {
+    unsigned int length = 0;
+    while (length < cell_size && cell[length] != '\0') {
+        ++length;
+    }
+    return length;
+}
+
+/**
+ * Given a string and its length, read the unsigned decimal number it starts 
+ * with, like sscanf with "%u" but without needing a terminating null.
+ * 
+ * args:
+ *  - target_string: the string to read.
+ *  - length: the number of chars that may be read.
+ * 
+ * return:
+ *  - the number read, or 0 if the string does not start with a digit.
+ */
+static unsigned int parse_unsigned_int(char *target_string, unsigned int length) {
+    unsigned int return_unsigned_int = 0;
+    unsigned int index = 0;
+    while (index < length && target_string[index] == ' ') {
+        ++index;
+    }
+    for (; index < length; ++index) {
+        if (target_string[index] < '0' || target_string[index] > '9') {
+            break;
+        }
+        return_unsigned_int = return_unsigned_int * 10 + (target_string[index] - '0');
+    }
+    return return_unsigned_int;
+}
+
+/**
+ * Given a zone map, make it empty. Zones are allocated as rows are added.
+ */
+static void zone_map_init(zone_map *zones) {
+    zones->zone_count = 0;
+    zones->minimums = NULL;
+    zones->maximums = NULL;
+    zones->row_counts = NULL;
+    zones->null_counts = NULL;
+    zones->null_rows = NULL;
+}
+
+/**
+ * Given a zone map, free its zones.
+ */
+static void deallocate_zone_map(zone_map *zones) {
+    free(zones->minimums);
+    free(zones->maximums);
+    free(zones->row_counts);
+    free(zones->null_counts);
+    free(zones->null_rows);
+    zone_map_init(zones);
+}
+
+/**
+ * Given a zone map, a row and its value, add the value to the stats of the
+ * zone of the row, or mark the row as empty. Each row must be added once.
+ * 
+ * args:
+ *  - zones: the zone map of the column.
+ *  - row: the row of the value.
+ *  - value: the value of the row.
+ *  - is_null: 1 if the cell of the value was empty and 0 if not.
+ */
+static void zone_map_add(zone_map *zones, unsigned int row, unsigned int value, char is_null) {
+    unsigned int zone = row / ZONE_ROWS;
+    if (zone >= zones->zone_count) {
+        unsigned int zone_count = zones->zone_count == 0 ? 1 : zones->zone_count;
+        while (zone_count <= zone) {
+            zone_count *= 2;
+        }
+        zones->minimums = realloc(zones->minimums, sizeof(unsigned int) * zone_count);
+        zones->maximums = realloc(zones->maximums, sizeof(unsigned int) * zone_count);
+        zones->row_counts = realloc(zones->row_counts, sizeof(unsigned int) * zone_count);
+        zones->null_counts = realloc(zones->null_counts, sizeof(unsigned int) * zone_count);
+        zones->null_rows = realloc(zones->null_rows, sizeof(unsigned long) * zone_count * (ZONE_ROWS / 64));
+        if (zones->minimums == NULL || zones->maximums == NULL ||
+            zones->row_counts == NULL || zones->null_counts == NULL || zones->null_rows == NULL) {
+            printf("Allocation fail [14]: could not grow the zone map.");
+            deallocate_zone_map(zones);
+            return;
+        }
+        for (unsigned int i = zones->zone_count; i < zone_count; ++i) {
+            zones->minimums[i] = -1;
+            zones->maximums[i] = 0;
+            zones->row_counts[i] = 0;
+            zones->null_counts[i] = 0;
+        }
+        memset(zones->null_rows + zones->zone_count * (ZONE_ROWS / 64), 0,
+               sizeof(unsigned long) * (zone_count - zones->zone_count) * (ZONE_ROWS / 64));
+        zones->zone_count = zone_count;
+    }
+    ++zones->row_counts[zone];
+    if (is_null) {
+        ++zones->null_counts[zone];
+        zones->null_rows[row / 64] |= 1UL << (row % 64);
+        return;
+    }
+    if (value < zones->minimums[zone]) {
+        zones->minimums[zone] = value;
+    }
+    if (value > zones->maximums[zone]) {
+        zones->maximums[zone] = value;
+    }
+}
+
+/**
+ * Given a zone map and a row that was added to it, find whether the cell of
+ * the row was empty.
+ * 
+ * return:
+ *  - 1 if the cell was empty and 0 if not or if the zone map has no zone
+ *    for the row.
+ */
+static char zone_map_is_null(zone_map *zones, unsigned int row) {
+    return row / ZONE_ROWS < zones->zone_count && (zones->null_rows[row / 64] >> (row % 64) & 1);
+}
+
+/**
+ * Given a model and a column mask, make it an empty model with room for
+ * `capacity` people in the columns of the mask. The other columns are NULL.
+ * 
+ * args:
+ *  - model: the model to initialize.
+ *  - column_mask: the COLUMN_ flags of the columns to allocate.
+ *  - capacity: the number of people to allocate room for.
+ */
+static void model_init(people_model *model, unsigned char column_mask, unsigned int capacity) {
+    model->count = 0;
+    model->column_mask = column_mask;
+    model->complete_mask = column_mask;
+    model->has_source = 0;
+    model->block_columns = NULL;
+    string_dict_init(&model->ids);
+    string_dict_init(&model->names);
+    model->id_codes = column_mask & COLUMN_ID ? allocate_unsigned_int(capacity) : NULL;
+    model->name_codes = column_mask & COLUMN_NAME ? allocate_unsigned_int(capacity) : NULL;
+    model->ages = column_mask & COLUMN_AGE ? allocate_unsigned_int(capacity) : NULL;
+    model->weights = column_mask & COLUMN_WEIGHT ? allocate_unsigned_int(capacity) : NULL;
+    zone_map_init(&model->age_zones);
+    zone_map_init(&model->weight_zones);
+}
+
+/**
+ * Given a table and a count, make a model of the `count` people in the rows
+ * of `table` that follow its header, without decoding any row yet.
+ * Rows are decoded when `model_require` is first called for them.
+ * 
+ * The table must stay allocated as long as the model is used.
+ * 
+ * args:
+ *  - model: the model to initialize.
+ *  - table: the table containing the data of the people.
+ *  - count: the number of people in the table.
+ */
+static void model_init_lazy(people_model *model, string_mat table, unsigned int count) {
+    model_init(model, COLUMN_ALL, count);
+    model->count = count;
+    model->complete_mask = 0;
+    model->has_source = 1;
+    model->source = table;
+    model->block_columns =
+        calloc(count / MODEL_BLOCK_ROWS + 1, sizeof(unsigned char));
+}
+
+/**
+ * Given a lazy model, a block index and a column mask, decode the columns 
+ * of the mask for the rows of the block from the source table.
+ * 
+ * The id and name columns are dictionary encoded: each distinct string is 
+ * stored once in the dictionary of the column and the rows hold its code.
+ * 
+ * args:
+ *  - model: the model to fill.
+ *  - block: the index of the block of rows.
+ *  - column_mask: the COLUMN_ flags of the columns to decode.
+ * 
+ * return:
+ *  - 1 on success and 0 if a dictionary could not grow. The block is then
+ *    left as not decoded.
+ */
+static char model_materialize_block(
+    people_model *model,
+    unsigned int block,
+    unsigned char column_mask) {
+
+    string_mat table = model->source;
+    unsigned int cell_size = table.cell_size[0];
+    unsigned int first_row = block * MODEL_BLOCK_ROWS;
+    unsigned int end_row = first_row + MODEL_BLOCK_ROWS;
+    if (end_row > model->count) {
+        end_row = model->count;
+    }
+
+    for (unsigned int i = first_row; i < end_row; ++i) {
+        char *row = table.inter_padded_strings +
+                    string_mat_get_absolute_index(table, i + 1, 0);
+        if (column_mask & COLUMN_ID) {
+            int code = string_dict_intern(&model->ids, row, cell_length(row, cell_size));
+            if (code < 0) {
+                return 0;
+            }
+            model->id_codes[i] = code;
+        }
+        if (column_mask & COLUMN_NAME) {
+            int code = string_dict_intern(
+                &model->names, row + cell_size, cell_length(row + cell_size, cell_size));
+            if (code < 0) {
+                return 0;
+            }
+            model->name_codes[i] = code;
+        }
+        if (column_mask & COLUMN_AGE) {
+            model->ages[i] = parse_unsigned_int(row + 2 * cell_size, cell_size);
+            zone_map_add(&model->age_zones, i, model->ages[i],
+                         cell_length(row + 2 * cell_size, cell_size) == 0);
+        }
+        if (column_mask & COLUMN_WEIGHT) {
+            model->weights[i] = parse_unsigned_int(row + 3 * cell_size, cell_size);
+            zone_map_add(&model->weight_zones, i, model->weights[i],
+                         cell_length(row + 3 * cell_size, cell_size) == 0);
+        }
+    }
+    model->block_columns[block] |= column_mask;
+    return 1;
+}
+
+/**
+ * Given a model, a column mask and a range of rows, make sure the columns of
+ * the mask are decoded for the rows of the range. Blocks that were decoded
+ * before are not decoded again.
+ * 
+ * args:
+ *  - model: the model about to be read.
+ *  - column_mask: the COLUMN_ flags of the columns about to be read.
+ *  - first_row: the first row about to be read.
+ *  - row_count: the number of rows about to be read.
+ * 
+ * return:
+ *  - 1 on success and 0 if a block could not be decoded.
+ */
+static char model_require(
+    people_model *model,
+    unsigned char column_mask,
+    unsigned int first_row,
+    unsigned int row_count) {
+
+    if ((model->complete_mask & column_mask) == column_mask || row_count == 0) {
+        return 1;
+    }
+    unsigned int first_block = first_row / MODEL_BLOCK_ROWS;
+    unsigned int last_block = (first_row + row_count - 1) / MODEL_BLOCK_ROWS;
+    for (unsigned int block = first_block; block <= last_block; ++block) {
+        unsigned char missing = column_mask & ~model->block_columns[block];
+        if (missing && !model_materialize_block(model, block, missing)) {
+            return 0;
+        }
+    }
+    if (first_row == 0 && row_count >= model->count) {
+        model->complete_mask |= column_mask;
+    }
+    return 1;
+}
+
+/**
+ * Given a model and a numeric column, return its zone map after making sure
+ * every row of the column was added to it.
+ * 
+ * args:
+ *  - model: the model. It must hold the column.
+ *  - column: COLUMN_AGE or COLUMN_WEIGHT.
+ * 
+ * return:
+ *  - the zone map, with (model->count + ZONE_ROWS - 1) / ZONE_ROWS zones in use.
+ */
+static zone_map *model_zone_map(people_model *model, unsigned char column) {
+    model_require(model, column, 0, model->count);
+    return column == COLUMN_AGE ? &model->age_zones : &model->weight_zones;
+}
+
+/**
+ * Given a model and a numeric column, find the smallest and largest value
+ * of the column from its zone map, without reading the column. Empty cells
+ * are left out.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the model is empty or every cell of the
+ *    column is.
+ */
+static char model_zone_range(people_model *model, unsigned char column, unsigned int *smallest, unsigned int *largest) {
+    zone_map *zones = model_zone_map(model, column);
+    unsigned int zone_count = (model->count + ZONE_ROWS - 1) / ZONE_ROWS;
+    if (model->count == 0 || zones->zone_count < zone_count) {
+        return 0;
+    }
+    *smallest = -1;
+    *largest = 0;
+    for (unsigned int zone = 0; zone < zone_count; ++zone) {
+        *smallest = zones->minimums[zone] < *smallest ? zones->minimums[zone] : *smallest;
+        *largest = zones->maximums[zone] > *largest ? zones->maximums[zone] : *largest;
+    }
+    return *smallest <= *largest;
+}
+
+/**
+ * Given a table and a count, build a model of `count` people from the rows 
+ * of `table` that follow its header. Every row is decoded before return.
+ * 
+ * NOTE: to deallocate a model created using this function, use 
+ * the deallocate_model function.
+ * 
+ * args:
+ *  - table: the table containing the data of the people.
+ *  - count: the number of people in the table.
+ * 
+ * return:
+ *  - the model.
+ */
+static people_model build_model(string_mat table, unsigned int count) {
+    people_model model;
+    model_init_lazy(&model, table, count);
+    model_require(&model, COLUMN_ALL, 0, count);
+    model.has_source = 0;
+    return model;
+}
+
+/**
+ * Given a model and a row, return a Person that views the row.
+ * 
+ * args:
+ *  - model: the model holding the row.
+ *  - row: the index of the person in the model.
+ * 
+ * return:
+ *  - a Person whose members point into the model.
+ */
+static Person model_get_person(people_model *model, unsigned int row) {
+    Person return_person;
+    return_person.id = string_dict_get(&model->ids, model->id_codes[row]);
+    return_person.name = string_dict_get(&model->names, model->name_codes[row]);
+    return_person.age = &model->ages[row];
+    return_person.weight = &model->weights[row];
+    return return_person;
+}
+
+/**
+ * Given a model and a row, return the name of the person in the row.
+ */
+static char *model_get_name(people_model *model, unsigned int row) {
+    return string_dict_get(&model->names, model->name_codes[row]);
+}
+
+/**
+ * Given a model and an id, find the row of the person with the id.
+ * The id is turned into its code once and the rows are compared by code.
+ * 
+ * If the id column of a lazy model is not decoded yet, the ids are compared
+ * in the source table instead and only the block of the found row is decoded.
+ * 
+ * args:
+ *  - model: the model to search.
+ *  - id: the id to search for.
+ * 
+ * return:
+ *  - the row of the person, or -1 if the id is not in the model.
+ */
+static int model_find_id(people_model *model, char *id) {
+    if (!(model->complete_mask & COLUMN_ID) && model->has_source) {
+        unsigned int cell_size = model->source.cell_size[0];
+        unsigned int id_length = string_length(id);
+        if (id_length > cell_size) {
+            return -1;
+        }
+        for (unsigned int row = 0; row < model->count; ++row) {
+            char *cell = model->source.inter_padded_strings +
+                         string_mat_get_absolute_index(model->source, row + 1, 0);
+            if (cell_length(cell, cell_size) == id_length &&
+                string_starts_with(cell, id)) {
+                model_require(model, COLUMN_ALL, row, 1);
+                return row;
+            }
+        }
+        return -1;
+    }
+    int code = string_dict_lookup(&model->ids, id);
+    if (code < 0) {
+        return -1;
+    }
+    for (unsigned int row = 0; row < model->count; ++row) {
+        if (model->id_codes[row] == (unsigned int)code) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Given a count, an number of new_lines, 
+ * and a string, print the string `count` times and then 
+ * print a new line `new_line` times.
+ * 
+ * args:
+ *  - count: number of times to print string.
+ *  - new_lines: number of new lines to print after 
+ *               the last print of string.
+ *  - string: the string to be printed.
+ * 
+*/
+static void print_times(
+    unsigned int count,
+    unsigned int new_lines,
+    char *string) {
+    for (unsigned int i = 0; i < count; ++i) {
+        printf("%s", string);
+    }
+    for (unsigned int i = 0; i < new_lines; ++i) {
+        printf("\n");
+    }
+}
+
+/**
+ * Given a Person, format and print its information. 
+ * 
+ * args:
+ *  - target_person: the person to print information of.
+ */
+static void print_person(Person target_person) {
+    printf(
+        "Person(\tid=%s,\n\tname=%s,\n\tage=%u,\n\tweight=%u\n)\n",
+        target_person.id, target_person.name, target_person.age[0],
+        target_person.weight[0]);
+}
+
+/**
+ * Given a string matrix, deallocate memory for all of its members.
+ * 
+ * args:
+ *  - table: the string matrix to deallocate members of.
+ */
+static void deallocate_string_mat(string_mat table) {
+    free(table.cell_size);
+    free(table.column_count);
+    free(table.row_count);
+    free(table.inter_padded_strings);
+}
+
+/**
+ * Given a model, deallocate memory for all of its members.
+ * 
+ * args:
+ *  - model: the model to deallocate members of.
+ */
+static void deallocate_model(people_model *model) {
+    free(model->block_columns);
+    deallocate_string_dict(&model->ids);
+    deallocate_string_dict(&model->names);
+    free(model->id_codes);
+    free(model->name_codes);
+    free(model->ages);
+    free(model->weights);
+    deallocate_zone_map(&model->age_zones);
+    deallocate_zone_map(&model->weight_zones);
+}
+
+/**
+ * Given a block ring, allocate its slots, aligned to STREAM_ALIGNMENT, and 
+ * initialize its locks.
+ * 
+ * args:
+ *  - ring: the ring to initialize.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the slots could not be allocated.
+ */
+static char block_ring_init(block_ring *ring) {
+    for (unsigned int i = 0; i < STREAM_RING_SLOTS; ++i) {
+        void *data = NULL;
+        ring->slots[i].data = posix_memalign(&data, STREAM_ALIGNMENT, STREAM_BLOCK_SIZE) == 0 ? data : NULL;
+        ring->slots[i].length = 0;
+        if (ring->slots[i].data == NULL) {
+            printf("Allocation fail [4]: could not allocate stream blocks.");
+            for (; i > 0; --i) {
+                free(ring->slots[i - 1].data);
+            }
+            return 0;
+        }
+    }
+    ring->head = 0;
+    ring->tail = 0;
+    ring->filled = 0;
+    ring->finished = 0;
+    ring->failed = 0;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->not_empty, NULL);
+    pthread_cond_init(&ring->not_full, NULL);
+    return 1;
+}
+
+/**
+ * Given a block ring, free its slots and destroy its locks.
+ * 
+ * args:
+ *  - ring: the ring to deallocate members of.
+ */
+static void deallocate_block_ring(block_ring *ring) {
+    for (unsigned int i = 0; i < STREAM_RING_SLOTS; ++i) {
+        free(ring->slots[i].data);
+    }
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->not_empty);
+    pthread_cond_destroy(&ring->not_full);
+}
+
+/**
+ * Called by the producer to get the empty block `ahead` blocks after the
+ * next one, so several blocks can be filled at once. They must still be
+ * published in order. Waits while that block is waiting to be consumed.
+ * 
+ * args:
+ *  - ring: the ring to take the block from.
+ *  - ahead: the number of blocks taken before it and not yet published.
+ *           Must be less than STREAM_RING_SLOTS.
+ * 
+ * return:
+ *  - the empty block.
+ */
+static stream_block *block_ring_acquire_ahead(block_ring *ring, unsigned int ahead) {
+    pthread_mutex_lock(&ring->lock);
+    while (ring->filled + ahead >= STREAM_RING_SLOTS) {
+        pthread_cond_wait(&ring->not_full, &ring->lock);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return &ring->slots[(ring->tail + ahead) % STREAM_RING_SLOTS];
+}
+
+/**
+ * Called by the producer to get the next empty block of the ring.
+ * Waits while all the blocks are waiting to be consumed.
+ * 
+ * args:
+ *  - ring: the ring to take the block from.
+ * 
+ * return:
+ *  - the empty block. Its data can be filled with up to STREAM_BLOCK_SIZE chars.
+ */
+static stream_block *block_ring_acquire_empty(block_ring *ring) {
+    return block_ring_acquire_ahead(ring, 0);
+}
+
+/**
+ * Called by the producer to hand the block taken with 
+ * `block_ring_acquire_empty` to the consumer.
+ * 
+ * args:
+ *  - ring: the ring the block belongs to.
+ *  - length: the number of chars written to the block.
+ */
+static void block_ring_publish(block_ring *ring, unsigned long length) {
+    pthread_mutex_lock(&ring->lock);
+    ring->slots[ring->tail].length = length;
+    ring->tail = (ring->tail + 1) % STREAM_RING_SLOTS;
+    ++ring->filled;
+    pthread_cond_signal(&ring->not_empty);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/**
+ * Called by the producer once it has no more blocks to publish.
+ * 
+ * args:
+ *  - ring: the ring to close.
+ *  - failed: 1 if the producer stopped because of an error, 0 otherwise.
+ */
+static void block_ring_close(block_ring *ring, char failed) {
+    pthread_mutex_lock(&ring->lock);
+    ring->finished = 1;
+    ring->failed = failed;
+    pthread_cond_signal(&ring->not_empty);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/**
+ * Called by the consumer to get the oldest published block.
+ * Waits while no block is published and the producer has not closed the ring.
+ * 
+ * args:
+ *  - ring: the ring to take the block from.
+ * 
+ * return:
+ *  - the filled block, or NULL if the producer closed the ring and all 
+ *    its blocks were consumed.
+ */
+static stream_block *block_ring_acquire_filled(block_ring *ring) {
+    stream_block *return_block = NULL;
+    pthread_mutex_lock(&ring->lock);
+    while (ring->filled == 0 && !ring->finished) {
+        pthread_cond_wait(&ring->not_empty, &ring->lock);
+    }
+    if (ring->filled > 0) {
+        return_block = &ring->slots[ring->head];
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return return_block;
+}
+
+/**
+ * Called by the consumer to give the block taken with 
+ * `block_ring_acquire_filled` back to the producer.
+ * 
+ * args:
+ *  - ring: the ring the block belongs to.
+ */
+static void block_ring_release(block_ring *ring) {
+    pthread_mutex_lock(&ring->lock);
+    ring->head = (ring->head + 1) % STREAM_RING_SLOTS;
+    --ring->filled;
+    pthread_cond_signal(&ring->not_full);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/**
+ * Given a file stream, find the compression format of its contents from their
+ * leading magic bytes. The stream is returned to its start.
+ * 
+ * args:
+ *  - input_file: the file stream to examine.
+ * 
+ * return:
+ *  - one of COMPRESSION_NONE, COMPRESSION_GZIP and COMPRESSION_ZSTD.
+ */
+static char detect_compression(FILE *input_file) {
+    unsigned char magic[4] = {0, 0, 0, 0};
+    size_t read_count = fread(magic, 1, 4, input_file);
+    fseek(input_file, 0, SEEK_SET);
+
+    if (read_count >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return COMPRESSION_GZIP;
+    }
+    if (read_count == 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+        magic[2] == 0x2f && magic[3] == 0xfd) {
+        return COMPRESSION_ZSTD;
+    }
+    return COMPRESSION_NONE;
+}
+
+/**
+ * Given a producer job, a block and an offset, fill the block from the file
+ * of the job at that offset, or from where the last read ended if the file
+ * can only be read in order.
+ * 
+ * return:
+ *  - the number of chars read, less than STREAM_BLOCK_SIZE only at the end
+ *    of the file, or -1 on a read error.
+ */
+static long read_file_block(stream_job *job, char *data, unsigned long offset) {
+    if (job->file_size < 0) {
+        size_t read_count = fread(data, 1, STREAM_BLOCK_SIZE, job->input_file);
+        return ferror(job->input_file) ? -1 : (long)read_count;
+    }
+    unsigned long length = 0;
+    while (length < STREAM_BLOCK_SIZE) {
+        ssize_t read_count = pread(job->descriptor, data + length,
+                                   STREAM_BLOCK_SIZE - length, offset + length);
+        if (read_count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read_count < 0) {
+            return -1;
+        }
+        if (read_count == 0) {
+            break;
+        }
+        length += read_count;
+    }
+    return length;
+}
+
+/**
+ * Copies an uncompressed file into the ring, one block at a time. 
+ * This is the portable reader: the producer thread blocks on one read at
+ * a time, which still overlaps with the table scan of the blocks before it.
+ * 
+ * args:
+ *  - job: the producer job with the file and the ring.
+ * 
+ * return:
+ *  - returns 1 on success and 0 on a read error.
+ */
+static char stream_plain_blocks(stream_job *job) {
+    unsigned long offset = 0;
+    while (1) {
+        stream_block *block = block_ring_acquire_empty(job->ring);
+        long read_count = read_file_block(job, block->data, offset);
+        if (read_count < 0) {
+            return 0;
+        }
+        if (read_count > 0) {
+            block_ring_publish(job->ring, read_count);
+        }
+        if (read_count < STREAM_BLOCK_SIZE) {
+            return 1;
+        }
+        offset += read_count;
+    }
+}
+
+#ifdef HAVE_IO_URING
+/**
+ * Given a reader and a number of entries, set up an io_uring instance with
+ * `io_uring_setup` and map its rings.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the kernel has no io_uring or refuses it.
+ */
+static char uring_reader_init(uring_reader *reader, unsigned int entry_count) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    reader->ring_descriptor = syscall(__NR_io_uring_setup, entry_count, &params);
+    if (reader->ring_descriptor < 0) {
+        return 0;
+    }
+
+    reader->submission_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    reader->completion_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (reader->completion_ring_size > reader->submission_ring_size) {
+            reader->submission_ring_size = reader->completion_ring_size;
+        }
+        reader->completion_ring_size = reader->submission_ring_size;
+    }
+    reader->entries_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    reader->submission_ring = mmap(NULL, reader->submission_ring_size, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, reader->ring_descriptor, IORING_OFF_SQ_RING);
+    reader->completion_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? reader->submission_ring :
+        mmap(NULL, reader->completion_ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, reader->ring_descriptor, IORING_OFF_CQ_RING);
+    reader->entries = mmap(NULL, reader->entries_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, reader->ring_descriptor, IORING_OFF_SQES);
+    if (reader->submission_ring == MAP_FAILED || reader->completion_ring == MAP_FAILED ||
+        reader->entries == MAP_FAILED) {
+        if (reader->entries != MAP_FAILED) {
+            munmap(reader->entries, reader->entries_size);
+        }
+        if (reader->completion_ring != MAP_FAILED && reader->completion_ring != reader->submission_ring) {
+            munmap(reader->completion_ring, reader->completion_ring_size);
+        }
+        if (reader->submission_ring != MAP_FAILED) {
+            munmap(reader->submission_ring, reader->submission_ring_size);
+        }
+        close(reader->ring_descriptor);
+        return 0;
+    }
+
+    char *submission_ring = reader->submission_ring;
+    char *completion_ring = reader->completion_ring;
+    reader->submission_tail = (unsigned int *)(submission_ring + params.sq_off.tail);
+    reader->submission_mask = (unsigned int *)(submission_ring + params.sq_off.ring_mask);
+    reader->submission_array = (unsigned int *)(submission_ring + params.sq_off.array);
+    reader->completion_head = (unsigned int *)(completion_ring + params.cq_off.head);
+    reader->completion_tail = (unsigned int *)(completion_ring + params.cq_off.tail);
+    reader->completion_mask = (unsigned int *)(completion_ring + params.cq_off.ring_mask);
+    reader->completions = (struct io_uring_cqe *)(completion_ring + params.cq_off.cqes);
+    return 1;
+}
+
+/**
+ * Given a reader, unmap its rings and close it.
+ * Reads still in flight are cancelled by the kernel.
+ */
+static void deallocate_uring_reader(uring_reader *reader) {
+    munmap(reader->entries, reader->entries_size);
+    if (reader->completion_ring != reader->submission_ring) {
+        munmap(reader->completion_ring, reader->completion_ring_size);
+    }
+    munmap(reader->submission_ring, reader->submission_ring_size);
+    close(reader->ring_descriptor);
+}
+
+/**
+ * Given a reader, queue a read of `length` chars of a file at `offset` into
+ * `data` and submit it with `io_uring_enter`. `tag` is given back with the
+ * completion of the read.
+ * 
+ * return:
+ *  - returns 1 if the read was submitted and 0 if not.
+ */
+static char uring_submit_read(
+    uring_reader *reader,
+    int descriptor,
+    char *data,
+    unsigned int length,
+    unsigned long offset,
+    unsigned long tag) {
+
+    unsigned int tail = *reader->submission_tail;
+    unsigned int index = tail & *reader->submission_mask;
+    struct io_uring_sqe *entry = &reader->entries[index];
+
+    memset(entry, 0, sizeof(*entry));
+    entry->opcode = IORING_OP_READ;
+    entry->fd = descriptor;
+    entry->addr = (unsigned long)data;
+    entry->len = length;
+    entry->off = offset;
+    entry->user_data = tag;
+    reader->submission_array[index] = index;
+    __atomic_store_n(reader->submission_tail, tail + 1, __ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter, reader->ring_descriptor, 1, 0, 0, NULL, 0) < 0) {
+        if (errno != EINTR) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Given a reader, wait for the next completed read.
+ * 
+ * args:
+ *  - tag: filled with the tag the read was submitted with.
+ *  - result: filled with the number of chars read, or minus the error number.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if waiting failed.
+ */
+static char uring_wait_read(uring_reader *reader, unsigned long *tag, int *result) {
+    while (1) {
+        unsigned int head = *reader->completion_head;
+        if (head != __atomic_load_n(reader->completion_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *completion = &reader->completions[head & *reader->completion_mask];
+            *tag = completion->user_data;
+            *result = completion->res;
+            __atomic_store_n(reader->completion_head, head + 1, __ATOMIC_RELEASE);
+            return 1;
+        }
+        if (syscall(__NR_io_uring_enter, reader->ring_descriptor, 0, 1,
+                    IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * Reads a plain regular file into the ring with io_uring, keeping up to
+ * STREAM_READS_IN_FLIGHT block reads in flight so the disk works ahead of 
+ * the table scan. Reads complete in any order but their blocks are 
+ * published in the order of the file. A short read before the end of the
+ * file is resubmitted for the rest of its block.
+ * 
+ * args:
+ *  - job: the producer job with the file and the ring.
+ * 
+ * return:
+ *  - returns 1 on success, 0 on a read error and -1 if io_uring is not
+ *    available, in which case nothing was published.
+ */
+static char stream_uring_blocks(stream_job *job) {
+    uring_reader reader;
+    unsigned long offsets[STREAM_RING_SLOTS];
+    unsigned long lengths[STREAM_RING_SLOTS];
+    char completed[STREAM_RING_SLOTS];
+    unsigned long submitted_blocks = 0;
+    unsigned long published_blocks = 0;
+    unsigned int in_flight = 0;
+    char status = 1;
+    char at_end = 0;
+
+    if (!uring_reader_init(&reader, STREAM_READS_IN_FLIGHT)) {
+        return -1;
+    }
+    while (1) {
+        while (status == 1 && !at_end && submitted_blocks - published_blocks < STREAM_READS_IN_FLIGHT &&
+               submitted_blocks * STREAM_BLOCK_SIZE < (unsigned long)job->file_size) {
+            stream_block *block =
+                block_ring_acquire_ahead(job->ring, submitted_blocks - published_blocks);
+            unsigned int slot = block - job->ring->slots;
+            offsets[slot] = submitted_blocks * STREAM_BLOCK_SIZE;
+            lengths[slot] = 0;
+            completed[slot] = 0;
+            if (!uring_submit_read(&reader, job->descriptor, block->data,
+                                   STREAM_BLOCK_SIZE, offsets[slot], slot)) {
+                status = published_blocks == 0 && in_flight == 0 ? -1 : 0;
+                break;
+            }
+            ++submitted_blocks;
+            ++in_flight;
+        }
+        if (in_flight == 0) {
+            break;
+        }
+
+        unsigned long slot;
+        int result;
+        if (!uring_wait_read(&reader, &slot, &result)) {
+            status = 0;
+            break;
+        }
+        --in_flight;
+        if (result < 0) {
+            if (status == 1) {
+                status = published_blocks == 0 && (result == -EINVAL || result == -EOPNOTSUPP) ? -1 : 0;
+            }
+            continue;
+        }
+        lengths[slot] += result;
+        unsigned long expected = (unsigned long)job->file_size - offsets[slot];
+        expected = expected < STREAM_BLOCK_SIZE ? expected : STREAM_BLOCK_SIZE;
+        if (status == 1 && result > 0 && lengths[slot] < expected) {
+            /* O_DIRECT reads must start on a sector, so the rest of a
+               short read is read again from the sector it ends in */
+            lengths[slot] -= lengths[slot] % STREAM_ALIGNMENT;
+            if (uring_submit_read(&reader, job->descriptor, job->ring->slots[slot].data + lengths[slot],
+                                  STREAM_BLOCK_SIZE - lengths[slot], offsets[slot] + lengths[slot], slot)) {
+                ++in_flight;
+                continue;
+            }
+            status = 0;
+        }
+        completed[slot] = 1;
+
+        while (status == 1 && published_blocks < submitted_blocks && completed[job->ring->tail]) {
+            unsigned long length = lengths[job->ring->tail];
+            completed[job->ring->tail] = 0;
+            if (length == 0) {
+                at_end = 1;
+                break;
+            }
+            block_ring_publish(job->ring, length);
+            ++published_blocks;
+        }
+    }
+    deallocate_uring_reader(&reader);
+    return status;
+}
+#endif
+
+#ifdef HAVE_ZLIB
+/**
+ * Inflates a gzip file stream into the ring, one block at a time.
+ * Files made of several concatenated gzip members are read to the end.
+ * 
+ * args:
+ *  - job: the producer job with the file stream and the ring.
+ * 
+ * return:
+ *  - returns 1 on success and 0 on a read or decompression error.
+ */
+static char stream_gzip_blocks(stream_job *job) {
+    unsigned char *input_buffer = malloc(STREAM_BLOCK_SIZE);
+    z_stream inflater;
+    int status = Z_OK;
+    char success = 1;
+
+    if (input_buffer == NULL) {
+        printf("Allocation fail [5]: could not allocate the inflate buffer.");
+        return 0;
+    }
+    inflater.zalloc = Z_NULL;
+    inflater.zfree = Z_NULL;
+    inflater.opaque = Z_NULL;
+    inflater.avail_in = 0;
+    inflater.next_in = Z_NULL;
+    if (inflateInit2(&inflater, 15 + 16) != Z_OK) {
+        free(input_buffer);
+        return 0;
+    }
+
+    stream_block *block = block_ring_acquire_empty(job->ring);
+    inflater.next_out = (unsigned char *)block->data;
+    inflater.avail_out = STREAM_BLOCK_SIZE;
+
+    while (1) {
+        if (inflater.avail_in == 0) {
+            inflater.avail_in =
+                fread(input_buffer, 1, STREAM_BLOCK_SIZE, job->input_file);
+            inflater.next_in = input_buffer;
+            if (inflater.avail_in == 0) {
+                success = (status == Z_STREAM_END) && !ferror(job->input_file);
+                break;
+            }
+        }
+
+        status = inflate(&inflater, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            inflateReset(&inflater);
+            status = Z_STREAM_END;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            success = 0;
+            break;
+        }
+
+        if (inflater.avail_out == 0) {
+            block_ring_publish(job->ring, STREAM_BLOCK_SIZE);
+            block = block_ring_acquire_empty(job->ring);
+            inflater.next_out = (unsigned char *)block->data;
+            inflater.avail_out = STREAM_BLOCK_SIZE;
+        }
+    }
+    if (inflater.avail_out < STREAM_BLOCK_SIZE) {
+        block_ring_publish(job->ring, STREAM_BLOCK_SIZE - inflater.avail_out);
+    }
+
+    inflateEnd(&inflater);
+    free(input_buffer);
+    return success;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/**
+ * Decompresses a zstd file stream into the ring, one block at a time.
+ * Files made of several concatenated zstd frames are read to the end.
+ * 
+ * args:
+ *  - job: the producer job with the file stream and the ring.
+ * 
+ * return:
+ *  - returns 1 on success and 0 on a read or decompression error.
+ */
+static char stream_zstd_blocks(stream_job *job) {
+    unsigned char *input_buffer = malloc(STREAM_BLOCK_SIZE);
+    ZSTD_DStream *decompressor = ZSTD_createDStream();
+    ZSTD_inBuffer input = {input_buffer, 0, 0};
+    ZSTD_outBuffer output;
+    size_t status = 0;
+    char success = 1;
+
+    if (input_buffer == NULL || decompressor == NULL) {
+        printf("Allocation fail [5]: could not allocate the zstd decoder.");
+        free(input_buffer);
+        ZSTD_freeDStream(decompressor);
+        return 0;
+    }
+    ZSTD_initDStream(decompressor);
+
+    stream_block *block = block_ring_acquire_empty(job->ring);
+    output.dst = block->data;
+    output.size = STREAM_BLOCK_SIZE;
+    output.pos = 0;
+
+    while (1) {
+        if (input.pos == input.size) {
+            input.size =
+                fread(input_buffer, 1, STREAM_BLOCK_SIZE, job->input_file);
+            input.pos = 0;
+            if (input.size == 0) {
+                success = (status == 0) && !ferror(job->input_file);
+                break;
+            }
+        }
+
+        status = ZSTD_decompressStream(decompressor, &output, &input);
+        if (ZSTD_isError(status)) {
+            success = 0;
+            break;
+        }
+
+        if (output.pos == output.size) {
+            block_ring_publish(job->ring, STREAM_BLOCK_SIZE);
+            block = block_ring_acquire_empty(job->ring);
+            output.dst = block->data;
+            output.pos = 0;
+        }
+    }
+    if (output.pos > 0) {
+        block_ring_publish(job->ring, output.pos);
+    }
+
+    ZSTD_freeDStream(decompressor);
+    free(input_buffer);
+    return success;
+}
+#endif
+
+/**
+ * The body of the producer thread started by `get_string_from_file_stream`.
+ * Reads, and if needed decompresses, the file stream of the job into its ring 
+ * and closes the ring when done.
+ * 
+ * args:
+ *  - job_pointer: a pointer to a stream_job.
+ * 
+ * return:
+ *  - always NULL. Errors are reported through the ring.
+ */
+static void *stream_producer(void *job_pointer) {
+    stream_job *job = job_pointer;
+    char success = 0;
+
+    switch (job->compression) {
+        case COMPRESSION_NONE:
+#ifdef HAVE_IO_URING
+            if (job->file_size > 0) {
+                success = stream_uring_blocks(job);
+                if (success != -1) {
+                    break;
+                }
+            }
+#endif
+            success = stream_plain_blocks(job);
+            break;
+
+        case COMPRESSION_GZIP:
+#ifdef HAVE_ZLIB
+            success = stream_gzip_blocks(job);
+#else
+            printf("This program was built without zlib: cannot read gzip files.\n");
+#endif
+            break;
+
+        case COMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+            success = stream_zstd_blocks(job);
+#else
+            printf("This program was built without libzstd: cannot read zstd files.\n");
+#endif
+            break;
+    }
+    block_ring_close(job->ring, !success);
+    return NULL;
+}
+
+/**
+ * Given an file stream, a consumer function and a context, read the file
+ * and call `consume(context, block, length)` for every block of its contents,
+ * in order.
+ * 
+ * Plain, gzip and zstd files are accepted. A producer thread reads and 
+ * decompresses the file into a ring of fixed-size blocks while this thread
+ * runs the consumer on them. Nothing is written to disk.
+ * 
+ * Plain regular files are read with io_uring when the kernel has it, with
+ * several reads in flight, and with one read at a time otherwise. If the
+ * environment variable PEOPLE_DIRECT_IO is "1" they are read with O_DIRECT,
+ * around the page cache, where the file system allows it.
+ * 
+ * args:
+ *  - input_file: the file steam to read.
+ *  - consume: called once per block. The block is only valid during the call.
+ *  - context: passed as is to consume.
+ * 
+ * return:
+ *  - returns 1 if the whole file was read and 0 if it could not be read or 
+ *    decompressed.
+ */
+static char stream_file_blocks(
+    FILE *input_file,
+    void (*consume)(void *context, char *block, unsigned long length),
+    void *context) {
+
+    block_ring ring;
+    stream_job job;
+    pthread_t producer;
+    stream_block *block;
+
+    struct stat file_status;
+    int descriptor_flags = -1;
+
+    job.input_file = input_file;
+    job.compression = detect_compression(input_file);
+    job.ring = &ring;
+    job.descriptor = fileno(input_file);
+    job.file_size = -1;
+    if (job.compression == COMPRESSION_NONE && fstat(job.descriptor, &file_status) == 0 &&
+        S_ISREG(file_status.st_mode)) {
+        job.file_size = file_status.st_size;
+#ifdef O_DIRECT
+        char *direct_io = getenv("PEOPLE_DIRECT_IO");
+        if (direct_io != NULL && strcmp(direct_io, "1") == 0) {
+            descriptor_flags = fcntl(job.descriptor, F_GETFL);
+            if (descriptor_flags < 0 || fcntl(job.descriptor, F_SETFL, descriptor_flags | O_DIRECT) < 0) {
+                descriptor_flags = -1;
+            }
+        }
+#endif
+    }
+    if (!block_ring_init(&ring)) {
+        return 0;
+    }
+    if (pthread_create(&producer, NULL, stream_producer, &job) != 0) {
+        /* the producer fills the ring while it is consumed, so without its
+           thread the file cannot be read */
+        printf("Could not start a thread to read the file.\n");
+        ring.failed = 1;
+    } else {
+        while ((block = block_ring_acquire_filled(&ring)) != NULL) {
+            consume(context, block->data, block->length);
+            block_ring_release(&ring);
+        }
+        pthread_join(producer, NULL);
+    }
+    if (descriptor_flags >= 0) {
+        fcntl(job.descriptor, F_SETFL, descriptor_flags);
+    }
+
+    char success = !ring.failed;
+    if (!success) {
+        printf("The file could not be read or decompressed.\n");
+    }
+    deallocate_block_ring(&ring);
+    return success;
+}
+
+/**
+ * A consumer of `stream_file_blocks` that appends the block to the string
+ * of a string_builder and runs the first reading pass of the table on it.
+ * 
+ * args:
+ *  - builder_pointer: a pointer to the string_builder.
+ *  - block: the block to append.
+ *  - length: the number of chars in block.
+ */
+static void append_block(void *builder_pointer, char *block, unsigned long length) {
+    string_builder *builder = builder_pointer;
+    if (builder->length + length + 1 > builder->capacity) {
+        while (builder->length + length + 1 > builder->capacity) {
+            builder->capacity *= 2;
+        }
+        builder->string = reallocate_string(builder->string, builder->capacity);
+    }
+    string_simple_copy(builder->string + builder->length, block, length);
+    if (builder->scan != NULL) {
+        table_scan_chunk(builder->scan, block, length);
+    }
+    builder->length += length;
+}
+
+/**
+ * Given an file stream, allocate and return a string that contain it contents.
+ * 
+ * The file is read with `stream_file_blocks`, so it can be compressed, and
+ * if a scan is given the first reading pass of the table runs on the
+ * blocks while the rest of the file is being read.
+ * 
+ * args:
+ *  - input_file: the file steam to dump contents of.
+ *  - scan: a table scan to fill with the first reading pass, or NULL.
+ * 
+ * return:
+ *  - a string with the contents of the file stream, or NULL if the file
+ *    could not be read or decompressed.
+ */
+static char *get_string_from_file_stream(FILE *input_file, table_scan *scan) {
+    string_builder builder;
+    builder.length = 0;
+    builder.capacity = STREAM_BLOCK_SIZE;
+    builder.scan = scan;
+
+    if (scan != NULL) {
+        table_scan_init(scan);
+    }
+    if (detect_compression(input_file) == COMPRESSION_NONE) {
+        fseek(input_file, 0, SEEK_END);
+        long file_size = ftell(input_file);
+        fseek(input_file, 0, SEEK_SET);
+        if (file_size > 0) {
+            builder.capacity = file_size + 1;
+        }
+    }
+    builder.string = malloc(sizeof(char) * builder.capacity);
+    if (builder.string == NULL) {
+        printf("Allocation fail [4]: returning NULL.");
+        return NULL;
+    }
+
+    if (!stream_file_blocks(input_file, append_block, &builder)) {
+        free(builder.string);
+        return NULL;
+    }
+    builder.string[builder.length] = '\0';
+    if (scan != NULL) {
+        table_scan_finish(scan);
+    }
+    return builder.string;
+}
+
+/**
+ * Given a 64 bit number, mix its bits so that every bit of the result
+ * depends on every bit of the number (the finalizer of splitmix64).
+ */
+static unsigned long mix_hash64(unsigned long value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9UL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebUL;
+    value ^= value >> 31;
+    return value;
+}
+
+/**
+ * Given a string and its length, compute its 64 bit FNV-1a hash, mixed so
+ * its top bits can pick a HyperLogLog register.
+ */
+static unsigned long string_hash64(char *target_string, unsigned int length) {
+    unsigned long hash = 14695981039346656037UL;
+    for (unsigned int index = 0; index < length; ++index) {
+        hash ^= (unsigned char)target_string[index];
+        hash *= 1099511628211UL;
+    }
+    return mix_hash64(hash);
+}
+
+/**
+ * Given a HyperLogLog sketch and the 64 bit hash of a value, add the value.
+ */
+static void hll_add(hll_sketch *sketch, unsigned long hash) {
+    unsigned int index = hash >> (64 - HLL_PRECISION);
+    unsigned long rest = hash << HLL_PRECISION;
+    unsigned char rank = 1;
+    while (rank <= 64 - HLL_PRECISION && !(rest & (1UL << 63))) {
+        rest <<= 1;
+        ++rank;
+    }
+    if (sketch->registers[index] < rank) {
+        sketch->registers[index] = rank;
+    }
+}
+
+/**
+ * Given two HyperLogLog sketches, add every value of `source` to `target`.
+ */
+static void hll_merge(hll_sketch *target, hll_sketch *source) {
+    for (unsigned int index = 0; index < HLL_REGISTERS; ++index) {
+        if (target->registers[index] < source->registers[index]) {
+            target->registers[index] = source->registers[index];
+        }
+    }
+}
+
+/**
+ * Given a HyperLogLog sketch, estimate the number of distinct values added.
+ * Small counts, when some registers are still empty, use linear counting.
+ * 
+ * return:
+ *  - the estimate. Its standard error is HLL_ERROR.
+ */
+static double hll_estimate(hll_sketch *sketch) {
+    double register_count = HLL_REGISTERS;
+    double harmonic_sum = 0;
+    unsigned int empty_count = 0;
+    for (unsigned int index = 0; index < HLL_REGISTERS; ++index) {
+        harmonic_sum += 1.0 / (1UL << sketch->registers[index]);
+        empty_count += sketch->registers[index] == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / register_count) * register_count * register_count / harmonic_sum;
+    if (estimate <= 2.5 * register_count && empty_count > 0) {
+        estimate = register_count * log(register_count / empty_count);
+    }
+    return estimate;
+}
+
+/**
+ * Given a KLL sketch, make it empty.
+ * 
+ * NOTE: to deallocate the sketch, use the deallocate_kll_sketch function.
+ */
+static void kll_init(kll_sketch *sketch) {
+    sketch->count = 0;
+    sketch->level_count = 0;
+    sketch->level_sizes = NULL;
+    sketch->level_capacities = NULL;
+    sketch->levels = NULL;
+    sketch->random_state = 0x9E3779B97F4A7C15UL;
+    sketch->compacted = 0;
+}
+
+/**
+ * Given a KLL sketch, deallocate memory for all of its levels.
+ */
+static void deallocate_kll_sketch(kll_sketch *sketch) {
+    for (unsigned int level = 0; level < sketch->level_count; ++level) {
+        free(sketch->levels[level]);
+    }
+    free(sketch->levels);
+    free(sketch->level_sizes);
+    free(sketch->level_capacities);
+    kll_init(sketch);
+}
+
+/**
+ * Given a KLL sketch, add a level on top of its levels.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if allocation fails.
+ */
+static char kll_add_level(kll_sketch *sketch) {
+    unsigned int level_count = sketch->level_count + 1;
+    unsigned int *level_sizes = realloc(sketch->level_sizes, sizeof(unsigned int) * level_count);
+    if (level_sizes == NULL) {
+        return 0;
+    }
+    sketch->level_sizes = level_sizes;
+    unsigned int *level_capacities = realloc(sketch->level_capacities, sizeof(unsigned int) * level_count);
+    if (level_capacities == NULL) {
+        return 0;
+    }
+    sketch->level_capacities = level_capacities;
+    unsigned int **levels = realloc(sketch->levels, sizeof(unsigned int *) * level_count);
+    if (levels == NULL) {
+        return 0;
+    }
+    sketch->levels = levels;
+    sketch->level_sizes[sketch->level_count] = 0;
+    sketch->level_capacities[sketch->level_count] = 8;
+    sketch->levels[sketch->level_count] = malloc(sizeof(unsigned int) * 8);
+    if (sketch->levels[sketch->level_count] == NULL) {
+        return 0;
+    }
+    sketch->level_count = level_count;
+    return 1;
+}
+
+/**
+ * Given a KLL sketch, a level and a value, append the value to the level.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if allocation fails.
+ */
+static char kll_append(kll_sketch *sketch, unsigned int level, unsigned int value) {
+    if (sketch->level_sizes[level] == sketch->level_capacities[level]) {
+        unsigned int *grown =
+            realloc(sketch->levels[level], sizeof(unsigned int) * 2 * sketch->level_capacities[level]);
+        if (grown == NULL) {
+            return 0;
+        }
+        sketch->levels[level] = grown;
+        sketch->level_capacities[level] *= 2;
+    }
+    sketch->levels[level][sketch->level_sizes[level]++] = value;
+    return 1;
+}
+
+/**
+ * Given a KLL sketch and one of its levels, find how many values the level
+ * holds before it is compacted: KLL_K for the top level and 2/3 of the
+ * level above it for the others, but never less than 2.
+ */
+static unsigned int kll_level_limit(kll_sketch *sketch, unsigned int level) {
+    double limit = KLL_K;
+    for (unsigned int depth = level + 1; depth < sketch->level_count; ++depth) {
+        limit = limit * 2 / 3;
+    }
+    return limit < 2 ? 2 : (unsigned int)limit;
+}
+
+/**
+ * Used by qsort to order unsigned ints.
+ */
+static int compare_unsigned_ints(const void *first, const void *second) {
+    unsigned int first_value = *(const unsigned int *)first;
+    unsigned int second_value = *(const unsigned int *)second;
+    return (first_value > second_value) - (first_value < second_value);
+}
+
+/**
+ * Given a KLL sketch, compact every level that holds more values than its 
+ * limit, from the lowest one up: the level is sorted and every other value,
+ * starting at a random one of the first two, moves to the level above with
+ * twice the weight. An odd value out stays, so no weight is lost.
+ */
+static void kll_compress(kll_sketch *sketch) {
+    for (unsigned int level = 0; level < sketch->level_count; ++level) {
+        if (sketch->level_sizes[level] < kll_level_limit(sketch, level)) {
+            continue;
+        }
+        if (level + 1 == sketch->level_count && !kll_add_level(sketch)) {
+            printf("Allocation fail [12]: the quantile sketch stops growing.");
+            return;
+        }
+        unsigned int *values = sketch->levels[level];
+        unsigned int size = sketch->level_sizes[level];
+        qsort(values, size, sizeof(unsigned int), compare_unsigned_ints);
+
+        sketch->random_state ^= sketch->random_state << 13;
+        sketch->random_state ^= sketch->random_state >> 7;
+        sketch->random_state ^= sketch->random_state << 17;
+        unsigned int kept = size % 2;
+        for (unsigned int index = kept + (sketch->random_state & 1); index < size; index += 2) {
+            kll_append(sketch, level + 1, values[index]);
+        }
+        sketch->level_sizes[level] = kept;
+        sketch->compacted = 1;
+    }
+}
+
+/**
+ * Given a KLL sketch and a value, add the value.
+ */
+static void kll_add(kll_sketch *sketch, unsigned int value) {
+    if (sketch->level_count == 0 && !kll_add_level(sketch)) {
+        return;
+    }
+    kll_append(sketch, 0, value);
+    ++sketch->count;
+    if (sketch->level_sizes[0] >= kll_level_limit(sketch, 0)) {
+        kll_compress(sketch);
+    }
+}
+
+/**
+ * Given two KLL sketches, add every value of `source` to `target`.
+ */
+static void kll_merge(kll_sketch *target, kll_sketch *source) {
+    for (unsigned int level = 0; level < source->level_count; ++level) {
+        while (target->level_count <= level) {
+            if (!kll_add_level(target)) {
+                return;
+            }
+        }
+        for (unsigned int index = 0; index < source->level_sizes[level]; ++index) {
+            kll_append(target, level, source->levels[level][index]);
+        }
+    }
+    target->count += source->count;
+    target->compacted |= source->compacted;
+    kll_compress(target);
+}
+
+/**
+ * Used by qsort to order (value, weight) pairs of a KLL sketch by value.
+ */
+static int compare_weighted_values(const void *first, const void *second) {
+    unsigned long first_value = *(const unsigned long *)first >> 8;
+    unsigned long second_value = *(const unsigned long *)second >> 8;
+    return (first_value > second_value) - (first_value < second_value);
+}
+
+/**
+ * Given a KLL sketch and a fraction, find the quantile of the values added:
+ * the smallest value with at least `fraction` of the values at or below it.
+ * 
+ * args:
+ *  - sketch: the sketch. It must not be empty.
+ *  - fraction: between 0 and 1, 0.95 for the 95th percentile.
+ * 
+ * return:
+ *  - the quantile. Its rank is off by at most KLL_RANK_ERROR of the values
+ *    with 99% confidence, or is exact if the sketch was never compacted.
+ */
+static unsigned int kll_quantile(kll_sketch *sketch, double fraction) {
+    unsigned int size = 0;
+    for (unsigned int level = 0; level < sketch->level_count; ++level) {
+        size += sketch->level_sizes[level];
+    }
+    unsigned long *weighted_values = malloc(sizeof(unsigned long) * (size + 1));
+    if (weighted_values == NULL) {
+        printf("Allocation fail [12]: returning 0.");
+        return 0;
+    }
+    unsigned int index = 0;
+    for (unsigned int level = 0; level < sketch->level_count; ++level) {
+        for (unsigned int i = 0; i < sketch->level_sizes[level]; ++i) {
+            weighted_values[index++] = (unsigned long)sketch->levels[level][i] << 8 | level;
+        }
+    }
+    qsort(weighted_values, size, sizeof(unsigned long), compare_weighted_values);
+
+    double target_weight = fraction * sketch->count;
+    unsigned long weight = 0;
+    unsigned int quantile = size > 0 ? weighted_values[size - 1] >> 8 : 0;
+    for (index = 0; index < size; ++index) {
+        weight += 1UL << (weighted_values[index] & 0xFF);
+        if (weight >= target_weight) {
+            quantile = weighted_values[index] >> 8;
+            break;
+        }
+    }
+    free(weighted_values);
+    return quantile;
+}
+
+/**
+ * Given sketches and a column mask, make them empty sketches of the columns 
+ * of the mask.
+ * 
+ * NOTE: to deallocate the sketches, use the deallocate_sketches function.
+ */
+static void sketches_init(people_sketches *sketches, unsigned char column_mask) {
+    memset(sketches->distinct, 0, sizeof(sketches->distinct));
+    sketches->column_mask = column_mask & COLUMN_ALL;
+    sketches->count = 0;
+    kll_init(&sketches->ages);
+    kll_init(&sketches->weights);
+}
+
+/**
+ * Given sketches, deallocate memory for all of their members.
+ */
+static void deallocate_sketches(people_sketches *sketches) {
+    deallocate_kll_sketch(&sketches->ages);
+    deallocate_kll_sketch(&sketches->weights);
+}
+
+/**
+ * Given sketches and the fields of one row, add the row to the sketches
+ * of the columns of their mask. The id and the name are given as hashes,
+ * see `string_hash64`, so a hash can be computed once per distinct string.
+ */
+static void sketches_add_row(
+    people_sketches *sketches,
+    unsigned long id_hash,
+    unsigned long name_hash,
+    unsigned int age,
+    unsigned int weight) {
+
+    if (sketches->column_mask & COLUMN_ID) {
+        hll_add(&sketches->distinct[0], id_hash);
+    }
+    if (sketches->column_mask & COLUMN_NAME) {
+        hll_add(&sketches->distinct[1], name_hash);
+    }
+    if (sketches->column_mask & COLUMN_AGE) {
+        hll_add(&sketches->distinct[2], mix_hash64(age));
+        kll_add(&sketches->ages, age);
+    }
+    if (sketches->column_mask & COLUMN_WEIGHT) {
+        hll_add(&sketches->distinct[3], mix_hash64(weight));
+        kll_add(&sketches->weights, weight);
+    }
+    ++sketches->count;
+}
+
+/**
+ * Given two sketches of the same columns, add every row of `source` to 
+ * `target`, as if the rows of both had been added to `target`.
+ */
+static void sketches_merge(people_sketches *target, people_sketches *source) {
+    for (unsigned int column = 0; column < 4; ++column) {
+        hll_merge(&target->distinct[column], &source->distinct[column]);
+    }
+    kll_merge(&target->ages, &source->ages);
+    kll_merge(&target->weights, &source->weights);
+    target->count += source->count;
+}
+
+/**
+ * Given a projection parser with sketches and one line of the file after
+ * the header, add the fields of the line to the sketches. Only the row 
+ * count of the model is kept, so memory does not grow with the file.
+ * 
+ * args:
+ *  - parser: the parser, whose `corrupt` is set if the line does not 
+ *            have 4 fields.
+ *  - line: the line, without its new line.
+ *  - length: the number of chars in line.
+ */
+static void projection_sketch_line(
+    projection_parser *parser,
+    char *line,
+    unsigned long length) {
+
+    unsigned long field_start = 0;
+    unsigned long hashes[2] = {0, 0};
+    unsigned int numbers[2] = {0, 0};
+    unsigned char column_mask = parser->sketches->column_mask;
+
+    for (unsigned int column = 0; column < 4; ++column) {
+        char *comma = memchr(line + field_start, ',', length - field_start);
+        unsigned long field_end = comma ? (unsigned long)(comma - line) : length;
+        unsigned int field_length = field_end - field_start;
+
+        if ((column == 3) != (comma == NULL)) {
+            parser->corrupt = 1;
+            return;
+        }
+        if (column < 2 && (column_mask & (1 << column))) {
+            hashes[column] = string_hash64(line + field_start, field_length);
+        } else if (column >= 2 && (column_mask & (1 << column))) {
+            numbers[column - 2] = parse_unsigned_int(line + field_start, field_length);
+        }
+        field_start = field_end + 1;
+    }
+    sketches_add_row(parser->sketches, hashes[0], hashes[1], numbers[0], numbers[1]);
+    ++parser->model->count;
+}
+
+/**
+ * Given a projection parser and one line of comma separated values, add the
+ * person of the line to the model of the parser.
+ * 
+ * Only the columns of the parser's mask are decoded. The fields of the other
+ * columns are only passed over to find the next comma.
+ * Empty lines and the header line are skipped, and a line that does not have
+ * 4 fields marks the parser as corrupt, as does a column that cannot grow.
+ * The lines that follow are then skipped.
+ * 
+ * args:
+ *  - parser_pointer: a pointer to the projection_parser holding the model.
+ *  - line: the first char of the line.
+ *  - length: the length of the line without its new line.
+ */
+static void projection_parse_line(
+    void *parser_pointer,
+    char *line,
+    unsigned long length) {
+
+    projection_parser *parser = parser_pointer;
+    people_model *model = parser->model;
+    unsigned long field_start = 0;
+    int code;
+
+    if (length == 0 || parser->corrupt) {
+        return;
+    }
+    if (!parser->header_done) {
+        parser->header_done = 1;
+        return;
+    }
+    if (parser->sketches != NULL) {
+        projection_sketch_line(parser, line, length);
+        return;
+    }
+    if (model->count == parser->capacity) {
+        unsigned int **columns[4] = {
+            &model->id_codes, &model->name_codes, &model->ages, &model->weights
+        };
+        for (unsigned int column = 0; column < 4; ++column) {
+            unsigned int *grown;
+            if (*columns[column] == NULL) {
+                continue;
+            }
+            grown = realloc(*columns[column], sizeof(unsigned int) * parser->capacity * 2);
+            if (grown == NULL) {
+                printf("Allocation fail [4]: could not grow the columns of the model.");
+                parser->corrupt = 1;
+                return;
+            }
+            *columns[column] = grown;
+        }
+        parser->capacity *= 2;
+    }
+
+    for (unsigned int column = 0; column < 4; ++column) {
+        char *comma = memchr(line + field_start, ',', length - field_start);
+        unsigned long field_end = comma ? (unsigned long)(comma - line) : length;
+        char *field = line + field_start;
+        unsigned int field_length = field_end - field_start;
+
+        if ((column == 3) != (comma == NULL)) {
+            parser->corrupt = 1;
+            return;
+        }
+        switch (column) {
+            case 0:
+                if (model->id_codes) {
+                    code = string_dict_intern(&model->ids, field, field_length);
+                    if (code < 0) {
+                        parser->corrupt = 1;
+                        return;
+                    }
+                    model->id_codes[model->count] = code;
+                }
+                break;
+            case 1:
+                if (model->name_codes) {
+                    code = string_dict_intern(&model->names, field, field_length);
+                    if (code < 0) {
+                        parser->corrupt = 1;
+                        return;
+                    }
+                    model->name_codes[model->count] = code;
+                }
+                break;
+            case 2:
+                if (model->ages) {
+                    model->ages[model->count] = parse_unsigned_int(field, field_length);
+                    zone_map_add(&model->age_zones, model->count, model->ages[model->count],
+                                 field_length == 0);
+                }
+                break;
+            case 3:
+                if (model->weights) {
+                    model->weights[model->count] = parse_unsigned_int(field, field_length);
+                    zone_map_add(&model->weight_zones, model->count, model->weights[model->count],
+                                 field_length == 0);
+                }
+                break;
+        }
+        field_start = field_end + 1;
+    }
+    ++model->count;
+}
+
+/**
+ * Given a line carry and a length, make room for `length` chars in its text.
+ * The capacity only grows once the text is reallocated.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if allocation fails, leaving the carry as is.
+ */
+static char carry_reserve(line_carry *carry, unsigned long length) {
+    unsigned long capacity = carry->capacity;
+    char *text;
+    if (length <= capacity) {
+        return 1;
+    }
+    while (length > capacity) {
+        capacity *= 2;
+    }
+    text = realloc(carry->text, capacity);
+    if (text == NULL) {
+        printf("Allocation fail [2]: could not carry a line to the next block.");
+        return 0;
+    }
+    carry->text = text;
+    carry->capacity = capacity;
+    return 1;
+}
+
+/**
+ * Given a line carry, a block of a file and a line parser, call 
+ * `parse_line(parser, line, length)` for every line the block completes, 
+ * without its new line. A line cut by the end of the block is kept in the 
+ * carry until the next block completes it. The last line of the file is 
+ * left in the carry if it does not end with a new line.
+ * 
+ * args:
+ *  - carry: the carry, with `length` 0 before the first block.
+ *  - block: the block to split.
+ *  - length: the number of chars in block.
+ *  - parse_line: called once per complete line.
+ *  - parser: passed as is to parse_line.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if a cut line could not be carried.
+ */
+static char split_block_lines(
+    line_carry *carry,
+    char *block,
+    unsigned long length,
+    void (*parse_line)(void *parser, char *line, unsigned long length),
+    void *parser) {
+
+    unsigned long line_start = 0;
+
+    if (carry->length > 0) {
+        char *new_line = memchr(block, '\n', length);
+        unsigned long taken = new_line ? (unsigned long)(new_line - block) : length;
+        if (!carry_reserve(carry, carry->length + taken)) {
+            return 0;
+        }
+        string_simple_copy(carry->text + carry->length, block, taken);
+        carry->length += taken;
+        if (new_line == NULL) {
+            return 1;
+        }
+        parse_line(parser, carry->text, carry->length);
+        carry->length = 0;
+        line_start = taken + 1;
+    }
+
+    while (line_start < length) {
+        char *new_line = memchr(block + line_start, '\n', length - line_start);
+        if (new_line == NULL) {
+            unsigned long left = length - line_start;
+            if (!carry_reserve(carry, left)) {
+                return 0;
+            }
+            string_simple_copy(carry->text, block + line_start, left);
+            carry->length = left;
+            return 1;
+        }
+        parse_line(parser, block + line_start, new_line - (block + line_start));
+        line_start = new_line - block + 1;
+    }
+    return 1;
+}
+
+/**
+ * A consumer of `stream_file_blocks` that parses the complete lines of the
+ * block into the model of a projection parser. A line cut by the end of the 
+ * block is kept in the parser until the next block completes it.
+ * 
+ * args:
+ *  - parser_pointer: a pointer to the projection_parser.
+ *  - block: the block to parse.
+ *  - length: the number of chars in block.
+ */
+static void projection_parse_block(void *parser_pointer, char *block, unsigned long length) {
+    projection_parser *parser = parser_pointer;
+    if (!split_block_lines(&parser->carry, block, length, projection_parse_line, parser)) {
+        parser->corrupt = 1;
+    }
+}
+
+/**
+ * Given an file stream of comma separated values and a column mask, build a
+ * model that only holds the columns of the mask, straight from the blocks
+ * of the file and without building a table.
+ * 
+ * With sketches, the columns of the mask are sketched in the same single 
+ * pass instead and the model only counts the rows, so any file size can be
+ * sketched in bounded memory.
+ * 
+ * args:
+ *  - input_file: the file stream to read.
+ *  - column_mask: the COLUMN_ flags of the columns to build.
+ *  - model: filled with the model.
+ *  - sketches: NULL, or sketches initialized for the columns to sketch.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the file could not be read or is corrupt.
+ */
+static char build_model_projected(
+    FILE *input_file,
+    unsigned char column_mask,
+    people_model *model,
+    people_sketches *sketches) {
+
+    projection_parser parser;
+    parser.model = model;
+    parser.sketches = sketches;
+    parser.capacity = 1024;
+    parser.header_done = 0;
+    parser.corrupt = 0;
+    parser.carry.length = 0;
+    parser.carry.capacity = 256;
+    parser.carry.text = malloc(sizeof(char) * parser.carry.capacity);
+    model_init(model, sketches ? 0 : column_mask & COLUMN_ALL, parser.capacity);
+
+    char success = stream_file_blocks(input_file, projection_parse_block, &parser);
+    if (success && parser.carry.length > 0) {
+        projection_parse_line(&parser, parser.carry.text, parser.carry.length);
+    }
+    free(parser.carry.text);
+
+    if (success && (parser.corrupt || model->count < 2)) {
+        printf("The CSV file is corrupt.\n");
+        success = 0;
+    }
+    if (!success) {
+        deallocate_model(model);
+    }
+    return success;
+}
+
+/**
+ * Given two strings, find if they are the same.
+ * 
+ * NOTE: the comparison stops only when the first null char is encountered.
+ * 
+ * args:
+ *  - first_string
+ *  - second_string
+ * 
+ * return:
+ *  - returns 1 if the string are equivalent and 0 if they are not.
+ */
+static char string_compare(char *first_string, char *second_string) {
+    unsigned int index = 0;
+    char current_char_1 = first_string[index];
+    char current_char_2 = second_string[index++];
+
+    while (1) {
+        if (current_char_1 == current_char_2) {
+            if (current_char_1 == '\0') {
+                return 1;
+            } 
+            current_char_1 = first_string[index];
+            current_char_2 = second_string[index++];
+        } else {
+            return 0;
+        }
+    }
+}
+
+/**
+ * Given a char, return its lowercase form if it is an uppercase ASCII letter.
+ */
+static unsigned char fold_char(char target_char) {
+    if (target_char >= 'A' && target_char <= 'Z') {
+        return target_char - 'A' + 'a';
+    }
+    return target_char;
+}
+
+/**
+ * Given two strings, compare them without regard to case, stopping after
+ * `limit` characters.
+ * 
+ * args:
+ *  - first_string
+ *  - second_string
+ *  - limit: the maximum number of characters to compare.
+ * 
+ * return:
+ *  - a negative number, 0 or a positive number if first_string orders
+ *    before, with or after second_string.
+ */
+static int string_fold_compare(char *first_string, char *second_string, unsigned int limit) {
+    for (unsigned int index = 0; index < limit; ++index) {
+        int difference =
+            fold_char(first_string[index]) - fold_char(second_string[index]);
+        if (difference != 0 || first_string[index] == '\0') {
+            return difference;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Given a string and a substring, find if the string contains the substring
+ * without regard to case.
+ * 
+ * args:
+ *  - target_string: the string to search in.
+ *  - substring: the string to search for.
+ *  - substring_length: the length of substring.
+ * 
+ * return:
+ *  - returns 1 if substring is found and 0 if not.
+ */
+static char string_fold_contains(
+    char *target_string,
+    char *substring,
+    unsigned int substring_length) {
+    for (unsigned int index = 0; target_string[index] != '\0'; ++index) {
+        if (string_fold_compare(target_string + index, substring, substring_length) == 0) {
+            return 1;
+        }
+    }
+    return substring_length == 0;
+}
+
+/**
+ * Given a string and an index in it, pack the 3 folded characters that start
+ * at the index into the key used by the trigram index.
+ */
+static unsigned int trigram_key(char *target_string, unsigned int index) {
+    return (fold_char(target_string[index]) << 16) |
+           (fold_char(target_string[index + 1]) << 8) |
+           fold_char(target_string[index + 2]);
+}
+
+/**
+ * The name index being sorted by `name_index_build`, as qsort passes no context.
+ */
+name_index *sorting_name_index;
+
+/**
+ * Used by qsort to order the rows of `sorting_name_index` by name.
+ */
+static int compare_rows_by_name(const void *first, const void *second) {
+    people_model *model = sorting_name_index->model;
+    unsigned int first_row = *(const unsigned int *)first;
+    unsigned int second_row = *(const unsigned int *)second;
+    int difference = string_fold_compare(
+        model_get_name(model, first_row), model_get_name(model, second_row), -1);
+    if (difference == 0) {
+        return (first_row > second_row) - (first_row < second_row);
+    }
+    return difference;
+}
+
+/**
+ * Used by qsort to order (trigram key, row) pairs.
+ */
+static int compare_trigram_pairs(const void *first, const void *second) {
+    unsigned long first_pair = *(const unsigned long *)first;
+    unsigned long second_pair = *(const unsigned long *)second;
+    return (first_pair > second_pair) - (first_pair < second_pair);
+}
+
+/**
+ * Given a name index, build it over its people if it is not built yet.
+ * 
+ * args:
+ *  - index: the index to build. Its model and count must be set.
+ */
+static void name_index_build(name_index *index) {
+    unsigned long pair_count = 0;
+    unsigned long *pairs;
+
+    if (index->built) {
+        return;
+    }
+
+    index->sorted_rows = allocate_unsigned_int(index->count);
+    for (unsigned int row = 0; row < index->count; ++row) {
+        index->sorted_rows[row] = row;
+        unsigned int length = string_length(model_get_name(index->model, row));
+        if (length >= 3) {
+            pair_count += length - 2;
+        }
+    }
+    sorting_name_index = index;
+    qsort(index->sorted_rows, index->count, sizeof(unsigned int), compare_rows_by_name);
+
+    pairs = malloc(sizeof(unsigned long) * (pair_count + 1));
+    pair_count = 0;
+    for (unsigned int row = 0; row < index->count; ++row) {
+        char *name = model_get_name(index->model, row);
+        unsigned int length = string_length(name);
+        for (unsigned int i = 0; i + 2 < length; ++i) {
+            pairs[pair_count++] = ((unsigned long)trigram_key(name, i) << 32) | row;
+        }
+    }
+    qsort(pairs, pair_count, sizeof(unsigned long), compare_trigram_pairs);
+
+    index->trigram_keys = allocate_unsigned_int(pair_count + 1);
+    index->posting_offsets = allocate_unsigned_int(pair_count + 2);
+    index->posting_rows = allocate_unsigned_int(pair_count + 1);
+    index->trigram_count = 0;
+    unsigned int posting_count = 0;
+    for (unsigned long i = 0; i < pair_count; ++i) {
+        if (i > 0 && pairs[i] == pairs[i - 1]) {
+            continue;
+        }
+        unsigned int key = pairs[i] >> 32;
+        if (index->trigram_count == 0 ||
+            index->trigram_keys[index->trigram_count - 1] != key) {
+            index->trigram_keys[index->trigram_count] = key;
+            index->posting_offsets[index->trigram_count++] = posting_count;
+        }
+        index->posting_rows[posting_count++] = pairs[i] & 0xffffffff;
+    }
+    index->posting_offsets[index->trigram_count] = posting_count;
+    free(pairs);
+    index->built = 1;
+}
+
+/**
+ * Given a name index, deallocate the memory of its structures.
+ * 
+ * args:
+ *  - index: the index to deallocate members of.
+ */
+static void deallocate_name_index(name_index *index) {
+    if (!index->built) {
+        return;
+    }
+    free(index->sorted_rows);
+    free(index->trigram_keys);
+    free(index->posting_offsets);
+    free(index->posting_rows);
+    index->built = 0;
+}
+
+/**
+ * Given a built name index and a prefix, call `found(context, row)` for every 
+ * row whose name starts with the prefix, in name order.
+ * 
+ * args:
+ *  - index: the index to search.
+ *  - prefix: the prefix to search for.
+ *  - found: called once per matching row.
+ *  - context: passed as is to found.
+ * 
+ * return:
+ *  - the number of matching rows.
+ */
+static unsigned int name_index_find_prefix(
+    name_index *index,
+    char *prefix,
+    void (*found)(void *context, unsigned int row),
+    void *context) {
+
+    unsigned int prefix_length = string_length(prefix);
+    unsigned int low = 0;
+    unsigned int high = index->count;
+    unsigned int match_count = 0;
+
+    while (low < high) {
+        unsigned int middle = low + (high - low) / 2;
+        if (string_fold_compare(model_get_name(index->model, index->sorted_rows[middle]),
+                                prefix, prefix_length) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (; low < index->count; ++low) {
+        unsigned int row = index->sorted_rows[low];
+        if (string_fold_compare(model_get_name(index->model, row), prefix, prefix_length) != 0) {
+            break;
+        }
+        found(context, row);
+        ++match_count;
+    }
+    return match_count;
+}
+
+/**
+ * Given a built name index and a trigram key, find the position of the key's
+ * posting list.
+ * 
+ * return:
+ *  - the position of the key in trigram_keys, or -1 if no name contains it.
+ */
+static int name_index_find_trigram(name_index *index, unsigned int key) {
+    unsigned int low = 0;
+    unsigned int high = index->trigram_count;
+    while (low < high) {
+        unsigned int middle = low + (high - low) / 2;
+        if (index->trigram_keys[middle] < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < index->trigram_count && index->trigram_keys[low] == key) {
+        return low;
+    }
+    return -1;
+}
+
+/**
+ * Given a built name index and a substring, call `found(context, row)` for
+ * every row whose name contains the substring, in row order.
+ * 
+ * The rows of the shortest posting list among the substring's trigrams are
+ * checked against the other posting lists and then against the name itself. 
+ * Substrings shorter than 3 characters fall back to checking every name.
+ * 
+ * args:
+ *  - index: the index to search.
+ *  - substring: the substring to search for.
+ *  - found: called once per matching row.
+ *  - context: passed as is to found.
+ * 
+ * return:
+ *  - the number of matching rows.
+ */
+static unsigned int name_index_find_substring(
+    name_index *index,
+    char *substring,
+    void (*found)(void *context, unsigned int row),
+    void *context) {
+
+    unsigned int substring_length = string_length(substring);
+    unsigned int match_count = 0;
+
+    if (substring_length < 3) {
+        for (unsigned int row = 0; row < index->count; ++row) {
+            if (string_fold_contains(model_get_name(index->model, row), substring, substring_length)) {
+                found(context, row);
+                ++match_count;
+            }
+        }
+        return match_count;
+    }
+
+    unsigned int list_count = substring_length - 2;
+    int *lists = malloc(sizeof(int) * list_count);
+    unsigned int *cursors = allocate_unsigned_int(list_count);
+    unsigned int shortest = 0;
+    for (unsigned int i = 0; i < list_count; ++i) {
+        lists[i] = name_index_find_trigram(index, trigram_key(substring, i));
+        if (lists[i] < 0) {
+            free(lists);
+            free(cursors);
+            return 0;
+        }
+        cursors[i] = index->posting_offsets[lists[i]];
+        if (index->posting_offsets[lists[i] + 1] - index->posting_offsets[lists[i]] <
+            index->posting_offsets[lists[shortest] + 1] - index->posting_offsets[lists[shortest]]) {
+            shortest = i;
+        }
+    }
+
+    for (unsigned int position = index->posting_offsets[lists[shortest]];
+         position < index->posting_offsets[lists[shortest] + 1]; ++position) {
+        unsigned int row = index->posting_rows[position];
+        char in_all_lists = 1;
+        for (unsigned int i = 0; i < list_count && in_all_lists; ++i) {
+            unsigned int end = index->posting_offsets[lists[i] + 1];
+            while (cursors[i] < end && index->posting_rows[cursors[i]] < row) {
+                ++cursors[i];
+            }
+            in_all_lists = cursors[i] < end && index->posting_rows[cursors[i]] == row;
+        }
+        if (in_all_lists &&
+            string_fold_contains(model_get_name(index->model, row), substring, substring_length)) {
+            found(context, row);
+            ++match_count;
+        }
+    }
+    free(lists);
+    free(cursors);
+    return match_count;
+}
+
+/**
+ * A callback of the name index searches that prints the id of a found row
+ * as soon as it is found.
+ * 
+ * args:
+ *  - model_pointer: the people_model that was indexed.
+ *  - row: the matching row of the model.
+ */
+static void print_found_id(void *model_pointer, unsigned int row) {
+    people_model *model = model_pointer;
+    model_require(model, COLUMN_ID, row, 1);
+    printf("%s\n", string_dict_get(&model->ids, model->id_codes[row]));
+}
+
+/**
+ * The body of each worker thread of a task pool.
+ * The worker runs the tasks of its own range and, once it is empty, 
+ * steals half of the tasks left in the range of another worker.
+ * It stops when no range has tasks left.
+ * 
+ * args:
+ *  - worker_pointer: a pointer to a task_worker.
+ * 
+ * return:
+ *  - always NULL.
+ */
+static void *task_pool_worker(void *worker_pointer) {
+    task_worker *worker = worker_pointer;
+    task_pool *pool = worker->pool;
+    task_range *own_range = &pool->ranges[worker->worker_index];
+
+    while (1) {
+        pthread_mutex_lock(&own_range->lock);
+        if (own_range->begin < own_range->end) {
+            unsigned int index = own_range->begin++;
+            pthread_mutex_unlock(&own_range->lock);
+            pool->task(pool->context, index);
+            continue;
+        }
+        pthread_mutex_unlock(&own_range->lock);
+
+        char stolen = 0;
+        for (unsigned int offset = 1; offset < pool->worker_count && !stolen; ++offset) {
+            task_range *victim =
+                &pool->ranges[(worker->worker_index + offset) % pool->worker_count];
+            pthread_mutex_lock(&victim->lock);
+            unsigned int left = victim->end - victim->begin;
+            if (victim->begin < victim->end) {
+                unsigned int stolen_end = victim->end;
+                victim->end -= (left + 1) / 2;
+                unsigned int stolen_begin = victim->end;
+                pthread_mutex_unlock(&victim->lock);
+
+                pthread_mutex_lock(&own_range->lock);
+                own_range->begin = stolen_begin;
+                own_range->end = stolen_end;
+                pthread_mutex_unlock(&own_range->lock);
+                stolen = 1;
+            } else {
+                pthread_mutex_unlock(&victim->lock);
+            }
+        }
+        if (!stolen) {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * Find the number of worker threads to use for parallel work.
+ * 
+ * return:
+ *  - the number of online processors, at least 1.
+ */
+static unsigned int get_worker_count(void) {
+    long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processor_count < 1) {
+        return 1;
+    }
+    return processor_count;
+}
+
+/**
+ * Given a task count, a task function and a context, call 
+ * `task(context, index)` once for every index from 0 to task_count - 1 on a
+ * work-stealing pool of threads, and return once all calls are done.
+ * 
+ * The indices are first split into one contiguous range per worker. 
+ * The calling thread is used as one of the workers. It steals from every
+ * other range until all are done, so the tasks of a worker whose thread 
+ * could not be created still run.
+ * 
+ * args:
+ *  - task_count: the number of tasks.
+ *  - task: the function that runs one task.
+ *  - context: passed as is to every call of task.
+ */
+static void run_parallel_tasks(
+    unsigned int task_count,
+    void (*task)(void *context, unsigned int index),
+    void *context) {
+
+    unsigned int worker_count = get_worker_count();
+    if (worker_count > task_count) {
+        worker_count = task_count;
+    }
+    if (worker_count <= 1) {
+        for (unsigned int index = 0; index < task_count; ++index) {
+            task(context, index);
+        }
+        return;
+    }
+
+    task_pool pool;
+    task_worker *workers = malloc(sizeof(task_worker) * worker_count);
+    pthread_t *threads = malloc(sizeof(pthread_t) * worker_count);
+    pool.ranges = malloc(sizeof(task_range) * worker_count);
+    pool.worker_count = worker_count;
+    pool.task = task;
+    pool.context = context;
+    if (workers == NULL || threads == NULL || pool.ranges == NULL) {
+        printf("Allocation fail [6]: running the tasks on one thread.");
+        free(workers);
+        free(threads);
+        free(pool.ranges);
+        for (unsigned int index = 0; index < task_count; ++index) {
+            task(context, index);
+        }
+        return;
+    }
+
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        pool.ranges[i].begin = (unsigned long)task_count * i / worker_count;
+        pool.ranges[i].end = (unsigned long)task_count * (i + 1) / worker_count;
+        pthread_mutex_init(&pool.ranges[i].lock, NULL);
+        workers[i].pool = &pool;
+        workers[i].worker_index = i;
+        workers[i].started = 0;
+    }
+    for (unsigned int i = 1; i < worker_count; ++i) {
+        workers[i].started = pthread_create(&threads[i], NULL, task_pool_worker, &workers[i]) == 0;
+    }
+    task_pool_worker(&workers[0]);
+    for (unsigned int i = 1; i < worker_count; ++i) {
+        if (workers[i].started) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        pthread_mutex_destroy(&pool.ranges[i].lock);
+    }
+    free(pool.ranges);
+    free(threads);
+    free(workers);
+}
+
+/**
+ * Given a string builder and a length, make room for `length` more chars
+ * in its string.
+ */
+static void builder_reserve(string_builder *builder, unsigned long length) {
+    if (builder->length + length + 1 > builder->capacity) {
+        while (builder->length + length + 1 > builder->capacity) {
+            builder->capacity *= 2;
+        }
+        builder->string = reallocate_string(builder->string, builder->capacity);
+    }
+}
+
+/**
+ * Given a string builder, a char and a count, append the char `count` times.
+ */
+static void builder_append_repeated(string_builder *builder, char target_char, unsigned int count) {
+    builder_reserve(builder, count);
+    memset(builder->string + builder->length, target_char, count);
+    builder->length += count;
+}
+
+/**
+ * Given an unsigned int and a buffer of at least 10 chars, write the int
+ * in decimal to the buffer, without a terminating null.
+ * 
+ * return:
+ *  - the number of chars written.
+ */
+static unsigned int format_unsigned_int(unsigned int value, char *text) {
+    char digits[10];
+    unsigned int digit_count = 0;
+    unsigned int length = 0;
+    do {
+        digits[digit_count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    while (digit_count > 0) {
+        text[length++] = digits[--digit_count];
+    }
+    return length;
+}
+
+/**
+ * Given a string builder and an unsigned int, append the int in decimal.
+ */
+static void builder_append_unsigned_int(string_builder *builder, unsigned int value) {
+    builder_reserve(builder, 10);
+    builder->length += format_unsigned_int(value, builder->string + builder->length);
+}
+
+/**
+ * The lines of output formatted by the tasks of `print_rendered_rows`: 
+ * `render_row(context, index, buffer)` appends the text of line `index`
+ * to the buffer, and chunk c of the current batch is formatted into 
+ * `buffers[c]`.
+*/
+typedef struct _render_job {
+
+    unsigned int row_count;
+    unsigned int first_chunk;
+    string_builder *buffers;
+    void (*render_row)(void *context, unsigned int index, string_builder *buffer);
+    void *context;
+} render_job;
+
+/**
+ * A task of `print_rendered_rows` that formats one chunk of lines into its
+ * buffer.
+ * 
+ * args:
+ *  - job_pointer: a pointer to the render_job.
+ *  - chunk: the index of the chunk in the current batch.
+ */
+static void render_rows_task(void *job_pointer, unsigned int chunk) {
+    render_job *job = job_pointer;
+    string_builder *buffer = &job->buffers[chunk];
+    unsigned int begin = (job->first_chunk + chunk) * RENDER_CHUNK_ROWS;
+    unsigned int end = begin + RENDER_CHUNK_ROWS < job->row_count ? begin + RENDER_CHUNK_ROWS : job->row_count;
+    buffer->length = 0;
+    for (unsigned int index = begin; index < end; ++index) {
+        job->render_row(job->context, index, buffer);
+    }
+}
+
+/**
+ * Given a number of lines and a function that formats one of them, print
+ * the lines in order.
+ * 
+ * The lines are split in chunks of RENDER_CHUNK_ROWS that are formatted in
+ * parallel, each into its own buffer, RENDER_BATCH_CHUNKS chunks at a time.
+ * The buffers of a batch are then written in order, so the output is the 
+ * same as formatting the lines one by one.
+ * 
+ * args:
+ *  - row_count: the number of lines.
+ *  - render_row: appends the text of a line to a buffer. It is called from
+ *                several threads at once, so it must not change shared data.
+ *  - context: passed as is to render_row.
+ */
+static void print_rendered_rows(
+    unsigned int row_count,
+    void (*render_row)(void *context, unsigned int index, string_builder *buffer),
+    void *context) {
+
+    render_job job;
+    unsigned int chunk_count = (row_count + RENDER_CHUNK_ROWS - 1) / RENDER_CHUNK_ROWS;
+    unsigned int buffer_count = chunk_count < RENDER_BATCH_CHUNKS ? chunk_count : RENDER_BATCH_CHUNKS;
+    job.row_count = row_count;
+    job.render_row = render_row;
+    job.context = context;
+    job.buffers = malloc(sizeof(string_builder) * (buffer_count + 1));
+    if (job.buffers == NULL) {
+        printf("Allocation fail [15]: could not print the rows.");
+        return;
+    }
+    for (unsigned int i = 0; i < buffer_count; ++i) {
+        job.buffers[i].capacity = STREAM_BLOCK_SIZE;
+        job.buffers[i].length = 0;
+        job.buffers[i].scan = NULL;
+        job.buffers[i].string = allocate_string(STREAM_BLOCK_SIZE);
+    }
+
+    for (job.first_chunk = 0; job.first_chunk < chunk_count; job.first_chunk += buffer_count) {
+        unsigned int batch_chunks = chunk_count - job.first_chunk < buffer_count ?
+                                    chunk_count - job.first_chunk : buffer_count;
+        run_parallel_tasks(batch_chunks, render_rows_task, &job);
+        for (unsigned int i = 0; i < batch_chunks; ++i) {
+            fwrite(job.buffers[i].string, 1, job.buffers[i].length, stdout);
+        }
+    }
+    for (unsigned int i = 0; i < buffer_count; ++i) {
+        free(job.buffers[i].string);
+    }
+    free(job.buffers);
+}
+
+/**
+ * The layout of a table being printed by `print_table_rows`: the width of
+ * every column, including its padding, the width of a whole line and the
+ * data rows to print. `widths` has a row of column widths per chunk of 
+ * the table while they are being measured.
+*/
+typedef struct _table_render {
+
+    string_mat table;
+    unsigned int *rows;
+    unsigned int *widths;
+    unsigned int line_width;
+} table_render;
+
+/**
+ * A task of `print_table_rows` that measures the longest cell of every
+ * column in one chunk of the rows of the table.
+ * 
+ * args:
+ *  - render_pointer: a pointer to the table_render.
+ *  - chunk: the index of the chunk of rows.
+ */
+static void measure_table_task(void *render_pointer, unsigned int chunk) {
+    table_render *render = render_pointer;
+    string_mat table = render->table;
+    unsigned int column_count = table.column_count[0];
+    unsigned int *widths = render->widths + chunk * column_count;
+    unsigned int begin = chunk * RENDER_CHUNK_ROWS;
+    unsigned int end = begin + RENDER_CHUNK_ROWS < table.row_count[0] ? begin + RENDER_CHUNK_ROWS : table.row_count[0];
+
+    for (unsigned int column = 0; column < column_count; ++column) {
+        widths[column] = 0;
+    }
+    for (unsigned int row = begin; row < end; ++row) {
+        char *cell = table.inter_padded_strings + string_mat_get_absolute_index(table, row, 0);
+        for (unsigned int column = 0; column < column_count; ++column, cell += table.cell_size[0]) {
+            unsigned int length = cell_length(cell, table.cell_size[0]);
+            if (length > widths[column]) {
+                widths[column] = length;
+            }
+        }
+    }
+}
+
+/**
+ * Formats line `index` of a table printed by `print_table_rows`: the 
+ * header for 0 and the data rows after it, each preceded by a line of
+ * dashes for the first two lines.
+ */
+static void render_table_row(void *render_pointer, unsigned int index, string_builder *buffer) {
+    table_render *render = render_pointer;
+    string_mat table = render->table;
+    unsigned int table_row = index == 0 || render->rows == NULL ? index : render->rows[index - 1] + 1;
+    char *cell = table.inter_padded_strings + string_mat_get_absolute_index(table, table_row, 0);
+
+    if (index == 0 || index == 1) {
+        builder_append_repeated(buffer, '-', render->line_width);
+        builder_append_repeated(buffer, '\n', 1);
+    }
+    builder_reserve(buffer, render->line_width + 1);
+    for (unsigned int column = 0; column < table.column_count[0]; ++column, cell += table.cell_size[0]) {
+        unsigned int length = cell_length(cell, table.cell_size[0]);
+        buffer->string[buffer->length++] = '|';
+        memcpy(buffer->string + buffer->length, cell, length);
+        memset(buffer->string + buffer->length + length, ' ', render->widths[column] - length);
+        buffer->length += render->widths[column];
+    }
+    buffer->string[buffer->length++] = '|';
+    buffer->string[buffer->length++] = '\n';
+}
+
+/**
+ * Given a table and an order of its data rows, print its contents to the 
+ * console, the header first and then the data rows in that order.
+ * The padding will be one plus the length of the longest string 
+ * in any respective column. 
+ * 
+ * The columns are measured and the rows formatted in parallel, see
+ * `print_rendered_rows`.
+ * 
+ * args:
+ *  - table: the table to print.
+ *  - rows: the data rows in the order to print them, where 0 is the row 
+ *          after the header, or NULL for the order of the table.
+ *  - row_count: the number of rows in `rows`. Ignored if `rows` is NULL.
+ */
+static void print_table_rows(string_mat table, unsigned int *rows, unsigned int row_count) {
+    table_render render;
+    unsigned int column_count = table.column_count[0];
+    unsigned int chunk_count = (table.row_count[0] + RENDER_CHUNK_ROWS - 1) / RENDER_CHUNK_ROWS;
+    render.table = table;
+    render.rows = rows;
+    render.widths = allocate_unsigned_int(column_count * (chunk_count + 1));
+
+    run_parallel_tasks(chunk_count, measure_table_task, &render);
+    render.line_width = column_count + 1;
+    for (unsigned int column = 0; column < column_count; ++column) {
+        for (unsigned int chunk = 1; chunk < chunk_count; ++chunk) {
+            if (render.widths[chunk * column_count + column] > render.widths[column]) {
+                render.widths[column] = render.widths[chunk * column_count + column];
+            }
+        }
+        render.widths[column] += 1;
+        render.line_width += render.widths[column];
+    }
+
+    print_rendered_rows(rows == NULL ? table.row_count[0] : row_count + 1, render_table_row, &render);
+    print_times(render.line_width, 2, "-");
+    free(render.widths);
+}
+
+/**
+ * Given a table, print its contents to the console in the order of the 
+ * table. See `print_table_rows`.
+ * 
+ * args:
+ *  - table: the table to print.
+ */
+static void print_table(string_mat table) {
+    print_table_rows(table, NULL, 0);
+}
+
+/**
+ * The people printed by `print_people`: the rows of `model` in `rows`, 
+ * or all of them in order if `rows` is NULL.
+*/
+typedef struct _people_render {
+
+    people_model *model;
+    unsigned int *rows;
+} people_render;
+
+/**
+ * Formats person `index` of `print_people` as `print_person` does.
+ */
+static void render_person(void *render_pointer, unsigned int index, string_builder *buffer) {
+    people_render *render = render_pointer;
+    people_model *model = render->model;
+    unsigned int row = render->rows == NULL ? index : render->rows[index];
+    char *id = string_dict_get(&model->ids, model->id_codes[row]);
+    char *name = string_dict_get(&model->names, model->name_codes[row]);
+    unsigned int id_length = string_length(id);
+    unsigned int name_length = string_length(name);
+
+    builder_reserve(buffer, id_length + name_length + 28);
+    memcpy(buffer->string + buffer->length, "Person(\tid=", 11);
+    memcpy(buffer->string + buffer->length + 11, id, id_length);
+    buffer->length += 11 + id_length;
+    memcpy(buffer->string + buffer->length, ",\n\tname=", 8);
+    memcpy(buffer->string + buffer->length + 8, name, name_length);
+    buffer->length += 8 + name_length;
+    memcpy(buffer->string + buffer->length, ",\n\tage=", 7);
+    buffer->length += 7;
+    builder_append_unsigned_int(buffer, model->ages[row]);
+    builder_reserve(buffer, 10);
+    memcpy(buffer->string + buffer->length, ",\n\tweight=", 10);
+    buffer->length += 10;
+    builder_append_unsigned_int(buffer, model->weights[row]);
+    builder_reserve(buffer, 3);
+    memcpy(buffer->string + buffer->length, "\n)\n", 3);
+    buffer->length += 3;
+}
+
+/**
+ * Given a model and some of its rows, print the person of each row as 
+ * `print_person` does, formatting them in parallel (see `print_rendered_rows`).
+ * 
+ * args:
+ *  - model: the model. Every column is decoded here if it is not yet.
+ *  - rows: the rows to print, or NULL for all the rows in order.
+ *  - row_count: the number of rows in `rows`. Ignored if `rows` is NULL.
+ */
+static void print_people(people_model *model, unsigned int *rows, unsigned int row_count) {
+    people_render render;
+    render.model = model;
+    render.rows = rows;
+    model_require(model, COLUMN_ALL, 0, model->count);
+    print_rendered_rows(rows == NULL ? model->count : row_count, render_person, &render);
+}
+
+/**
+ * Given a sort job and a chunk, find the first item of the chunk.
+ * `chunk_count` is the end of the last chunk.
+ */
+static unsigned int sort_chunk_begin(sort_job *job, unsigned int chunk) {
+    if (chunk >= job->chunk_count) {
+        return job->count;
+    }
+    return (unsigned long)job->count * chunk / job->chunk_count;
+}
+
+/**
+ * Given an item count, find the number of chunks to sort them in.
+ */
+static unsigned int get_sort_chunk_count(unsigned int count) {
+    if (count < SORT_PARALLEL_ROWS) {
+        return 1;
+    }
+    return get_worker_count();
+}
+
+/**
+ * A task of `radix_sort_rows`: count the digits of the keys of one chunk.
+ */
+static void radix_count_task(void *job_pointer, unsigned int chunk) {
+    sort_job *job = job_pointer;
+    unsigned long *histogram = job->histograms + (unsigned long)chunk * SORT_RADIX;
+    unsigned int end = sort_chunk_begin(job, chunk + 1);
+
+    memset(histogram, 0, sizeof(unsigned long) * SORT_RADIX);
+    for (unsigned int i = sort_chunk_begin(job, chunk); i < end; ++i) {
+        ++histogram[((job->keys[job->rows[i]] ^ job->flip) >> job->shift) & (SORT_RADIX - 1)];
+    }
+}
+
+/**
+ * A task of `radix_sort_rows`: move the rows of one chunk to the places 
+ * of their digits. Rows keep their order inside a digit.
+ */
+static void radix_scatter_task(void *job_pointer, unsigned int chunk) {
+    sort_job *job = job_pointer;
+    unsigned long *histogram = job->histograms + (unsigned long)chunk * SORT_RADIX;
+    unsigned int end = sort_chunk_begin(job, chunk + 1);
+
+    for (unsigned int i = sort_chunk_begin(job, chunk); i < end; ++i) {
+        unsigned int row = job->rows[i];
+        job->sorted_rows[histogram[((job->keys[row] ^ job->flip) >> job->shift) & (SORT_RADIX - 1)]++] = row;
+    }
+}
+
+/**
+ * Given a key for every row, find the order of the rows by their keys with
+ * a least significant digit radix sort. Only the row numbers are moved.
+ * 
+ * Every pass counts the digits of each chunk in parallel, finds where each
+ * chunk writes each digit and then moves the rows of each chunk in parallel.
+ * Passes over bytes that are the same in every key are skipped, so small
+ * keys such as ages take one pass.
+ * 
+ * NOTE: the returned array must be freed.
+ * 
+ * args:
+ *  - keys: the key of each row.
+ *  - count: the number of rows.
+ *  - descending: 1 to order the keys from the largest.
+ * 
+ * return:
+ *  - the rows in sorted order, or NULL if allocation fails. Rows with 
+ *    equal keys keep their order.
+ */
+static unsigned int *radix_sort_rows(unsigned int *keys, unsigned int count, char descending) {
+    sort_job job;
+    unsigned int differing_bits = 0;
+    job.count = count;
+    job.chunk_count = get_sort_chunk_count(count);
+    job.keys = keys;
+    job.flip = descending ? -1 : 0;
+    job.rows = malloc(sizeof(unsigned int) * (count + 1));
+    job.sorted_rows = malloc(sizeof(unsigned int) * (count + 1));
+    job.histograms = malloc(sizeof(unsigned long) * SORT_RADIX * job.chunk_count);
+    if (job.rows == NULL || job.sorted_rows == NULL || job.histograms == NULL) {
+        printf("Allocation fail [10]: could not sort the rows.");
+        free(job.rows);
+        free(job.sorted_rows);
+        free(job.histograms);
+        return NULL;
+    }
+
+    for (unsigned int row = 0; row < count; ++row) {
+        job.rows[row] = row;
+        differing_bits |= keys[row] ^ keys[0];
+    }
+    for (job.shift = 0; job.shift < 32; job.shift += 8) {
+        if (((differing_bits >> job.shift) & (SORT_RADIX - 1)) == 0) {
+            continue;
+        }
+        run_parallel_tasks(job.chunk_count, radix_count_task, &job);
+
+        unsigned long offset = 0;
+        for (unsigned int digit = 0; digit < SORT_RADIX; ++digit) {
+            for (unsigned int chunk = 0; chunk < job.chunk_count; ++chunk) {
+                unsigned long *slot = &job.histograms[(unsigned long)chunk * SORT_RADIX + digit];
+                unsigned long digit_count = *slot;
+                *slot = offset;
+                offset += digit_count;
+            }
+        }
+        run_parallel_tasks(job.chunk_count, radix_scatter_task, &job);
+
+        unsigned int *swap = job.rows;
+        job.rows = job.sorted_rows;
+        job.sorted_rows = swap;
+    }
+    free(job.sorted_rows);
+    free(job.histograms);
+    return job.rows;
+}
+
+/**
+ * Given a string, find its first 8 bytes as a number, with the first byte
+ * as the most significant one and zeros after the end of the string.
+ */
+static unsigned long string_prefix_key(char *target_string) {
+    unsigned long prefix = 0;
+    char ended = 0;
+    for (unsigned int index = 0; index < 8; ++index) {
+        ended = ended || target_string[index] == '\0';
+        prefix = prefix << 8 | (ended ? 0 : (unsigned char)target_string[index]);
+    }
+    return prefix;
+}
+
+/**
+ * Given two entries of the same dictionary, compare their strings byte by
+ * byte. The cached prefixes decide unless they are equal and both strings
+ * go on after them.
+ * 
+ * return:
+ *  - a negative number, 0 or a positive number, as strcmp.
+ */
+static int compare_sort_entries(sort_entry *first, sort_entry *second, string_dict *dict) {
+    if (first->prefix != second->prefix) {
+        return first->prefix < second->prefix ? -1 : 1;
+    }
+    if ((first->prefix & 0xFF) == 0) {
+        return 0;
+    }
+    return strcmp(string_dict_get(dict, first->code) + 8, string_dict_get(dict, second->code) + 8);
+}
+
+/**
+ * Given two sorted runs next to each other in `source`, merge them into the
+ * same place in `target`. Entries of the first run go first on ties.
+ * 
+ * args:
+ *  - begin: the first entry of the first run.
+ *  - middle: the first entry of the second run.
+ *  - end: one past the last entry of the second run.
+ */
+static void merge_sort_entries(
+    sort_entry *source,
+    sort_entry *target,
+    unsigned int begin,
+    unsigned int middle,
+    unsigned int end,
+    string_dict *dict) {
+
+    unsigned int left = begin;
+    unsigned int right = middle;
+    for (unsigned int index = begin; index < end; ++index) {
+        if (left < middle &&
+            (right >= end || compare_sort_entries(&source[left], &source[right], dict) <= 0)) {
+            target[index] = source[left++];
+        } else {
+            target[index] = source[right++];
+        }
+    }
+}
+
+/**
+ * A task of `sort_dictionary`: merge sort the entries of one chunk, bottom
+ * up, and leave them sorted in `entries`.
+ */
+static void merge_sort_chunk_task(void *job_pointer, unsigned int chunk) {
+    sort_job *job = job_pointer;
+    unsigned int begin = sort_chunk_begin(job, chunk);
+    unsigned int end = sort_chunk_begin(job, chunk + 1);
+    sort_entry *source = job->entries;
+    sort_entry *target = job->merged_entries;
+
+    for (unsigned int width = 1; width < end - begin; width *= 2) {
+        for (unsigned int left = begin; left < end; left += 2 * width) {
+            unsigned int middle = left + width < end ? left + width : end;
+            unsigned int right = middle + width < end ? middle + width : end;
+            merge_sort_entries(source, target, left, middle, right, job->dict);
+        }
+        sort_entry *swap = source;
+        source = target;
+        target = swap;
+    }
+    if (source != job->entries) {
+        memcpy(job->entries + begin, source + begin, sizeof(sort_entry) * (end - begin));
+    }
+}
+
+/**
+ * A task of `sort_dictionary`: merge two neighbouring runs of `width` 
+ * sorted chunks each from `entries` into `merged_entries`.
+ */
+static void merge_chunk_runs_task(void *job_pointer, unsigned int pair) {
+    sort_job *job = job_pointer;
+    unsigned int first_chunk = pair * 2 * job->width;
+    merge_sort_entries(
+        job->entries, job->merged_entries,
+        sort_chunk_begin(job, first_chunk),
+        sort_chunk_begin(job, first_chunk + job->width),
+        sort_chunk_begin(job, first_chunk + 2 * job->width),
+        job->dict);
+}
+
+/**
+ * Given a dictionary, find the rank of every code in the byte order of the 
+ * strings, with a parallel merge sort of the distinct strings. Each chunk is
+ * sorted by its own task, then runs of chunks are merged in pairs, one task
+ * per pair, until one run is left.
+ * 
+ * NOTE: the returned array must be freed.
+ * 
+ * args:
+ *  - dict: the dictionary to sort.
+ *  - descending: 1 to rank the strings from the last.
+ * 
+ * return:
+ *  - the rank of each code, or NULL if allocation fails.
+ */
+static unsigned int *sort_dictionary(string_dict *dict, char descending) {
+    sort_job job;
+    unsigned int *ranks = malloc(sizeof(unsigned int) * (dict->count + 1));
+    job.count = dict->count;
+    job.chunk_count = get_sort_chunk_count(dict->count);
+    job.dict = dict;
+    job.entries = malloc(sizeof(sort_entry) * (dict->count + 1));
+    job.merged_entries = malloc(sizeof(sort_entry) * (dict->count + 1));
+    if (ranks == NULL || job.entries == NULL || job.merged_entries == NULL) {
+        printf("Allocation fail [10]: could not sort the rows.");
+        free(ranks);
+        free(job.entries);
+        free(job.merged_entries);
+        return NULL;
+    }
+
+    for (unsigned int code = 0; code < dict->count; ++code) {
+        job.entries[code].prefix = string_prefix_key(string_dict_get(dict, code));
+        job.entries[code].code = code;
+    }
+    run_parallel_tasks(job.chunk_count, merge_sort_chunk_task, &job);
+    for (job.width = 1; job.width < job.chunk_count; job.width *= 2) {
+        unsigned int pair_count = (job.chunk_count + 2 * job.width - 1) / (2 * job.width);
+        run_parallel_tasks(pair_count, merge_chunk_runs_task, &job);
+        sort_entry *swap = job.entries;
+        job.entries = job.merged_entries;
+        job.merged_entries = swap;
+    }
+
+    for (unsigned int rank = 0; rank < dict->count; ++rank) {
+        ranks[job.entries[rank].code] = descending ? dict->count - 1 - rank : rank;
+    }
+    free(job.entries);
+    free(job.merged_entries);
+    return ranks;
+}
+
+/**
+ * Given a model and a column, find the order of the rows of the model by
+ * the column. Nothing in the model is moved.
+ * 
+ * Ages and weights are radix sorted directly. For ids and names, only the 
+ * distinct strings of the dictionary are compared: they are ranked by 
+ * `sort_dictionary` and the rows are then radix sorted by the rank of 
+ * their code.
+ * 
+ * NOTE: the returned array must be freed.
+ * 
+ * args:
+ *  - model: the model to sort. The column is decoded if it is not yet.
+ *  - column: one COLUMN_ flag.
+ *  - descending: 1 for descending order.
+ * 
+ * return:
+ *  - the rows in sorted order, or NULL if the column is not in the 
+ *    model or allocation fails. Rows with equal values keep their order.
+ */
+static unsigned int *sort_model_rows(people_model *model, unsigned char column, char descending) {
+    unsigned int *codes;
+    string_dict *dict;
+    if (!(model->column_mask & column)) {
+        return NULL;
+    }
+    model_require(model, column, 0, model->count);
+
+    switch (column) {
+        case COLUMN_AGE:
+            return radix_sort_rows(model->ages, model->count, descending);
+        case COLUMN_WEIGHT:
+            return radix_sort_rows(model->weights, model->count, descending);
+        case COLUMN_ID:
+            codes = model->id_codes;
+            dict = &model->ids;
+            break;
+        case COLUMN_NAME:
+            codes = model->name_codes;
+            dict = &model->names;
+            break;
+        default:
+            return NULL;
+    }
+
+    unsigned int *ranks = sort_dictionary(dict, descending);
+    unsigned int *keys = malloc(sizeof(unsigned int) * (model->count + 1));
+    unsigned int *rows = NULL;
+    if (ranks != NULL && keys != NULL) {
+        for (unsigned int row = 0; row < model->count; ++row) {
+            keys[row] = ranks[codes[row]];
+        }
+        rows = radix_sort_rows(keys, model->count, 0);
+    }
+    free(ranks);
+    free(keys);
+    return rows;
+}
+
+/**
+ * Given the text of a mode, find if it is a sort mode:
+ * "sort by " and a column name, optionally followed by " desc".
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - column: filled with the COLUMN_ flag of the column.
+ *  - descending: filled with 1 if the mode ends with " desc" and 0 if not.
+ * 
+ * return:
+ *  - returns 1 if the mode is a valid sort mode and 0 if not.
+ */
+static char parse_sort_mode(char *user_input, unsigned char *column, char *descending) {
+    char *column_names[] = {"id", "name", "age", "weight"};
+    unsigned char columns[] = {COLUMN_ID, COLUMN_NAME, COLUMN_AGE, COLUMN_WEIGHT};
+    if (!string_starts_with(user_input, "sort by ")) {
+        return 0;
+    }
+    char *column_name = user_input + 8;
+
+    for (unsigned int i = 0; i < 4; ++i) {
+        unsigned int length = strlen(column_names[i]);
+        if (strncmp(column_name, column_names[i], length) != 0) {
+            continue;
+        }
+        if (column_name[length] == '\0' || string_compare(column_name + length, " desc")) {
+            *column = columns[i];
+            *descending = column_name[length] != '\0';
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Given a table, a data row and a column, find the cell without copying it.
+ * Cells are padded with nulls but are not null terminated when they fill 
+ * the whole cell, see `cell_length`.
+ * 
+ * args:
+ *  - row: the data row, where 0 is the row after the header.
+ */
+static char *table_data_cell(string_mat table, unsigned int row, unsigned int column) {
+    return table.inter_padded_strings + string_mat_get_absolute_index(table, row + 1, column);
+}
+
+/**
+ * Given the path of a CSV file, build its table. Any number of columns is
+ * accepted, as long as every row has as many as the header.
+ * 
+ * NOTE: to deallocate the table, use the deallocate_string_mat function.
+ * 
+ * args:
+ *  - path: the path of the file, plain or compressed.
+ *  - table: filled with the table.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the file is missing or corrupt.
+ */
+static char read_table_file(char *path, string_mat *table) {
+    table_scan scan;
+    FILE *input_file = fopen(path, "rb");
+    if (!input_file) {
+        printf("No such file found: \"%s\".\n", path);
+        return 0;
+    }
+    char *raw_string = get_string_from_file_stream(input_file, &scan);
+    fclose(input_file);
+    if (raw_string == NULL) {
+        return 0;
+    }
+    *table = build_table_from_scan(raw_string, scan);
+    free(raw_string);
+    if (!validate_table(*table, table->column_count[0])) {
+        printf("The CSV file \"%s\" is corrupt.\n", path);
+        deallocate_string_mat(*table);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Given one side of a join and the number of partition bits, hash the key of
+ * every data row and group the rows by partition: the top bits of the hash.
+ * The rows of a partition keep their order.
+ * 
+ * args:
+ *  - side: the side, with its table and key column set.
+ *  - partition_bits: 0 for a single partition.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if allocation fails.
+ */
+static char join_side_partition(join_side *side, unsigned int partition_bits) {
+    unsigned int partition_count = 1 << partition_bits;
+    unsigned int cell_size = side->table.cell_size[0];
+    unsigned int *partitions = malloc(sizeof(unsigned int) * (side->count + 1));
+    side->hashes = malloc(sizeof(unsigned int) * (side->count + 1));
+    side->partition_offsets = calloc(partition_count + 1, sizeof(unsigned int));
+    side->partition_rows = NULL;
+    if (partitions == NULL || side->hashes == NULL || side->partition_offsets == NULL) {
+        free(partitions);
+        return 0;
+    }
+
+    for (unsigned int row = 0; row < side->count; ++row) {
+        char *cell = table_data_cell(side->table, row, side->key_column);
+        side->hashes[row] = string_hash(cell, cell_length(cell, cell_size));
+        partitions[row] = partition_bits ? side->hashes[row] >> (32 - partition_bits) : 0;
+        ++side->partition_offsets[partitions[row] + 1];
+    }
+    for (unsigned int partition = 0; partition < partition_count; ++partition) {
+        side->partition_offsets[partition + 1] += side->partition_offsets[partition];
+    }
+    side->partition_rows = radix_sort_rows(partitions, side->count, 0);
+    free(partitions);
+    return side->partition_rows != NULL;
+}
+
+/**
+ * Given two sides of a join and a row of each, find if their keys are equal.
+ */
+static char join_keys_equal(join_side *first, unsigned int first_row, join_side *second, unsigned int second_row) {
+    char *first_cell = table_data_cell(first->table, first_row, first->key_column);
+    char *second_cell = table_data_cell(second->table, second_row, second->key_column);
+    unsigned int length = cell_length(first_cell, first->table.cell_size[0]);
+    return length == cell_length(second_cell, second->table.cell_size[0]) &&
+           memcmp(first_cell, second_cell, length) == 0;
+}
+
+/**
+ * A task of `join_tables`: join the rows of one partition of both sides.
+ * 
+ * The build rows of the partition are put in a chained hash table, indexed
+ * by the low bits of their hash, and every probe row of the partition is 
+ * looked up in it. Chains list the build rows in their order, so the pairs
+ * of every probe row come out in the order of both tables.
+ */
+static void join_partition_task(void *job_pointer, unsigned int partition) {
+    join_job *job = job_pointer;
+    join_side *build = job->build;
+    join_side *probe = job->probe;
+    unsigned int build_begin = build->partition_offsets[partition];
+    unsigned int build_count = build->partition_offsets[partition + 1] - build_begin;
+    unsigned int bucket_count = 1;
+    unsigned int capacity = 16;
+    unsigned int match_count = 0;
+    unsigned int *matches = malloc(sizeof(unsigned int) * 2 * capacity);
+
+    while (bucket_count < 2 * build_count) {
+        bucket_count <<= 1;
+    }
+    int *heads = malloc(sizeof(int) * bucket_count);
+    int *next = malloc(sizeof(int) * (build_count + 1));
+    if (matches == NULL || heads == NULL || next == NULL) {
+        printf("Allocation fail [11]: a partition of the join is skipped.");
+        goto after_join_partition;
+    }
+    memset(heads, -1, sizeof(int) * bucket_count);
+
+    for (unsigned int entry = build_count; entry-- > 0;) {
+        unsigned int bucket = build->hashes[build->partition_rows[build_begin + entry]] & (bucket_count - 1);
+        next[entry] = heads[bucket];
+        heads[bucket] = entry;
+    }
+
+    for (unsigned int i = probe->partition_offsets[partition];
+         i < probe->partition_offsets[partition + 1]; ++i) {
+        unsigned int probe_row = probe->partition_rows[i];
+        unsigned int hash = probe->hashes[probe_row];
+        for (int entry = heads[hash & (bucket_count - 1)]; entry >= 0; entry = next[entry]) {
+            unsigned int build_row = build->partition_rows[build_begin + entry];
+            if (build->hashes[build_row] != hash ||
+                !join_keys_equal(build, build_row, probe, probe_row)) {
+                continue;
+            }
+            if (match_count == capacity) {
+                capacity *= 2;
+                unsigned int *grown = realloc(matches, sizeof(unsigned int) * 2 * capacity);
+                if (grown == NULL) {
+                    printf("Allocation fail [11]: a partition of the join is cut short.");
+                    goto after_join_partition;
+                }
+                matches = grown;
+            }
+            matches[2 * match_count] = job->build_is_left ? build_row : probe_row;
+            matches[2 * match_count + 1] = job->build_is_left ? probe_row : build_row;
+            ++match_count;
+        }
+    }
+
+after_join_partition:
+    job->matches[partition] = matches;
+    job->match_counts[partition] = match_count;
+    free(heads);
+    free(next);
+}
+
+/**
+ * Given two tables and the column of the key in each, find every pair of 
+ * data rows with equal keys, with a hash join.
+ * 
+ * The hash table is built on the side with less rows and the other side
+ * probes it. When the build side has more than JOIN_PARTITION_ROWS rows, both
+ * sides are first radix partitioned by the top bits of the hash and the 
+ * partitions are joined in parallel, so the hash table of each partition
+ * stays small enough for the cache.
+ * 
+ * NOTE: to deallocate the result, use the deallocate_join_result function.
+ * 
+ * args:
+ *  - left: the left table.
+ *  - left_key_column: the column of the key in the left table.
+ *  - right: the right table.
+ *  - right_key_column: the column of the key in the right table.
+ * 
+ * return:
+ *  - the pairs, ordered by left row and then by right row. Its count is 0
+ *    if allocation fails.
+ */
+static join_result join_tables(
+    string_mat left,
+    unsigned int left_key_column,
+    string_mat right,
+    unsigned int right_key_column) {
+
+    join_result result = {0, NULL, NULL};
+    join_side left_side = {left, left_key_column, left.row_count[0] - 1, NULL, NULL, NULL};
+    join_side right_side = {right, right_key_column, right.row_count[0] - 1, NULL, NULL, NULL};
+    join_job job;
+    job.build_is_left = left_side.count <= right_side.count;
+    job.build = job.build_is_left ? &left_side : &right_side;
+    job.probe = job.build_is_left ? &right_side : &left_side;
+    job.partition_bits = job.build->count > JOIN_PARTITION_ROWS ? JOIN_PARTITION_BITS : 0;
+
+    unsigned int partition_count = 1 << job.partition_bits;
+    job.matches = calloc(partition_count, sizeof(unsigned int *));
+    job.match_counts = calloc(partition_count, sizeof(unsigned int));
+    if (job.matches == NULL || job.match_counts == NULL ||
+        !join_side_partition(&left_side, job.partition_bits) ||
+        !join_side_partition(&right_side, job.partition_bits)) {
+        printf("Allocation fail [11]: could not join the tables.");
+        goto after_join;
+    }
+    run_parallel_tasks(partition_count, join_partition_task, &job);
+
+    unsigned int total = 0;
+    for (unsigned int partition = 0; partition < partition_count; ++partition) {
+        total += job.match_counts[partition];
+    }
+    unsigned int *left_rows = malloc(sizeof(unsigned int) * (total + 1));
+    unsigned int *right_rows = malloc(sizeof(unsigned int) * (total + 1));
+    result.left_rows = malloc(sizeof(unsigned int) * (total + 1));
+    result.right_rows = malloc(sizeof(unsigned int) * (total + 1));
+    if (left_rows != NULL && right_rows != NULL &&
+        result.left_rows != NULL && result.right_rows != NULL) {
+        unsigned int index = 0;
+        for (unsigned int partition = 0; partition < partition_count; ++partition) {
+            for (unsigned int i = 0; i < job.match_counts[partition]; ++i) {
+                left_rows[index] = job.matches[partition][2 * i];
+                right_rows[index++] = job.matches[partition][2 * i + 1];
+            }
+        }
+        unsigned int *order = radix_sort_rows(left_rows, total, 0);
+        for (unsigned int i = 0; order != NULL && i < total; ++i) {
+            result.left_rows[i] = left_rows[order[i]];
+            result.right_rows[i] = right_rows[order[i]];
+        }
+        result.count = order != NULL ? total : 0;
+        free(order);
+    }
+    free(left_rows);
+    free(right_rows);
+
+after_join:
+    for (unsigned int partition = 0; job.matches != NULL && partition < partition_count; ++partition) {
+        free(job.matches[partition]);
+    }
+    free(job.matches);
+    free(job.match_counts);
+    free(left_side.hashes);
+    free(left_side.partition_rows);
+    free(left_side.partition_offsets);
+    free(right_side.hashes);
+    free(right_side.partition_rows);
+    free(right_side.partition_offsets);
+    return result;
+}
+
+/**
+ * Given a join result, deallocate memory for all of its members.
+ */
+static void deallocate_join_result(join_result result) {
+    free(result.left_rows);
+    free(result.right_rows);
+}
+
+/**
+ * Given two tables and the pairs of rows of their join, build the table of 
+ * the joined rows: the columns of the left table and then the columns of
+ * the right table, without its key column.
+ * 
+ * As the columns of the left table come first, a people table on the left
+ * gives a table that a lazy model can be built over.
+ * 
+ * NOTE: to deallocate the table, use the deallocate_string_mat function.
+ * 
+ * return:
+ *  - the joined table, with a header and one data row per pair.
+ */
+static string_mat build_joined_table(
+    string_mat left,
+    string_mat right,
+    unsigned int right_key_column,
+    join_result join) {
+
+    string_mat table;
+    unsigned int left_columns = left.column_count[0];
+    unsigned int right_columns = right.column_count[0];
+    unsigned int cell_size = left.cell_size[0] > right.cell_size[0] ? left.cell_size[0] : right.cell_size[0];
+
+    table.column_count = malloc(sizeof(unsigned long));
+    table.row_count = malloc(sizeof(unsigned long));
+    table.cell_size = malloc(sizeof(unsigned long));
+    table.column_count[0] = left_columns + right_columns - 1;
+    table.row_count[0] = join.count + 1;
+    table.cell_size[0] = cell_size;
+    table.inter_padded_strings =
+        calloc((unsigned long)cell_size * table.column_count[0] * table.row_count[0], sizeof(char));
+
+    for (unsigned int row = 0; row < table.row_count[0]; ++row) {
+        unsigned int left_row = row == 0 ? 0 : join.left_rows[row - 1] + 1;
+        unsigned int right_row = row == 0 ? 0 : join.right_rows[row - 1] + 1;
+        char *target = table.inter_padded_strings + string_mat_get_absolute_index(table, row, 0);
+
+        for (unsigned int column = 0; column < left_columns; ++column) {
+            char *cell = left.inter_padded_strings + string_mat_get_absolute_index(left, left_row, column);
+            memcpy(target, cell, cell_length(cell, left.cell_size[0]));
+            target += cell_size;
+        }
+        for (unsigned int column = 0; column < right_columns; ++column) {
+            if (column == right_key_column) {
+                continue;
+            }
+            char *cell = right.inter_padded_strings + string_mat_get_absolute_index(right, right_row, column);
+            memcpy(target, cell, cell_length(cell, right.cell_size[0]));
+            target += cell_size;
+        }
+    }
+    return table;
+}
+
+/**
+ * Given the text of a mode, find if it is a join mode: "join ", the path
+ * of another CSV file and " on id".
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - path: filled with the path of the other file. Must hold 261 chars.
+ * 
+ * return:
+ *  - returns 1 if the mode is a valid join mode and 0 if not.
+ */
+static char parse_join_mode(char *user_input, char *path) {
+    unsigned int length = string_length(user_input);
+    if (!string_starts_with(user_input, "join ") || length <= 11 ||
+        !string_compare(user_input + length - 6, " on id") || length - 11 > 260) {
+        return 0;
+    }
+    snprintf(path, 261, "%.*s", length - 11, user_input + 5);
+    return 1;
+}
+
+/**
+ * Given the table of the people and the path of another CSV file whose
+ * first column is an id, join the people with the rows of the file by id,
+ * then print the joined table and the aggregates of the joined rows: the
+ * number of rows, the average age and weight and the average of every other
+ * column of the file that only holds numbers.
+ * 
+ * args:
+ *  - table: the table of the people.
+ *  - path: the path of the other file.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the other file could not be read.
+ */
+static char print_join(string_mat table, char *path) {
+    string_mat other;
+    if (!read_table_file(path, &other)) {
+        return 0;
+    }
+    join_result join = join_tables(table, 0, other, 0);
+    string_mat joined = build_joined_table(table, other, 0, join);
+    print_table(joined);
+
+    unsigned int matched_people = 0;
+    for (unsigned int i = 0; i < join.count; ++i) {
+        matched_people += i == 0 || join.left_rows[i] != join.left_rows[i - 1];
+    }
+    printf("%u rows joined, %u of %u people have a match\n",
+           join.count, matched_people, (unsigned int)table.row_count[0] - 1);
+
+    if (join.count > 0) {
+        people_model model;
+        unsigned long age_sum = 0;
+        unsigned long weight_sum = 0;
+        model_init_lazy(&model, joined, join.count);
+        model_require(&model, COLUMN_AGE | COLUMN_WEIGHT, 0, join.count);
+        for (unsigned int row = 0; row < join.count; ++row) {
+            age_sum += model.ages[row];
+            weight_sum += model.weights[row];
+        }
+        printf("The average age is %0.2f\n", (double)age_sum / join.count);
+        printf("The average weight is %0.2f\n", (double)weight_sum / join.count);
+        deallocate_model(&model);
+
+        unsigned int cell_size = joined.cell_size[0];
+        for (unsigned int column = table.column_count[0]; column < joined.column_count[0]; ++column) {
+            unsigned long column_sum = 0;
+            char numeric = 1;
+            for (unsigned int row = 0; row < join.count && numeric; ++row) {
+                char *cell = table_data_cell(joined, row, column);
+                unsigned int length = cell_length(cell, cell_size);
+                for (unsigned int index = 0; index < length && numeric; ++index) {
+                    numeric = cell[index] >= '0' && cell[index] <= '9';
+                }
+                numeric = numeric && length > 0;
+                column_sum += parse_unsigned_int(cell, length);
+            }
+            if (numeric) {
+                char *header = joined.inter_padded_strings + string_mat_get_absolute_index(joined, 0, column);
+                printf("The average %.*s is %0.2f\n", cell_length(header, cell_size), header,
+                       (double)column_sum / join.count);
+            }
+        }
+    }
+    print_times(50, 2, "-");
+
+    deallocate_string_mat(joined);
+    deallocate_join_result(join);
+    deallocate_string_mat(other);
+    return 1;
+}
+
+/**
+ * The shared state of `sketch_model`: one set of sketches per chunk of 
+ * SKETCH_CHUNK_ROWS rows of the model, and the hash of every id and name
+ * code, computed once per distinct string.
+*/
+typedef struct _sketch_job {
+
+    people_model *model;
+    unsigned char column_mask;
+    unsigned long *id_hashes;
+    unsigned long *name_hashes;
+    people_sketches *chunk_sketches;
+} sketch_job;
+
+/**
+ * A task of `sketch_model`: add the rows of one chunk to its sketches.
+ */
+static void sketch_model_task(void *job_pointer, unsigned int chunk) {
+    sketch_job *job = job_pointer;
+    people_model *model = job->model;
+    people_sketches *sketches = &job->chunk_sketches[chunk];
+    unsigned int first_row = chunk * SKETCH_CHUNK_ROWS;
+    unsigned int end_row = first_row + SKETCH_CHUNK_ROWS < model->count ?
+                           first_row + SKETCH_CHUNK_ROWS : model->count;
+
+    sketches_init(sketches, job->column_mask);
+    for (unsigned int row = first_row; row < end_row; ++row) {
+        sketches_add_row(
+            sketches,
+            job->id_hashes ? job->id_hashes[model->id_codes[row]] : 0,
+            job->name_hashes ? job->name_hashes[model->name_codes[row]] : 0,
+            model->ages ? model->ages[row] : 0,
+            model->weights ? model->weights[row] : 0);
+    }
+}
+
+/**
+ * Given a string dictionary, hash the string of every code.
+ * 
+ * NOTE: the returned array must be freed.
+ */
+static unsigned long *hash_dictionary(string_dict *dict) {
+    unsigned long *hashes = malloc(sizeof(unsigned long) * (dict->count + 1));
+    for (unsigned int code = 0; hashes != NULL && code < dict->count; ++code) {
+        char *target_string = string_dict_get(dict, code);
+        hashes[code] = string_hash64(target_string, string_length(target_string));
+    }
+    return hashes;
+}
+
+/**
+ * Given a model and a column mask, build the sketches of the columns of the
+ * mask over the rows of the model. The rows are split in chunks that are 
+ * sketched in parallel and the sketches of the chunks are then merged.
+ * 
+ * args:
+ *  - model: the model. The columns are decoded if they are not yet.
+ *  - column_mask: the COLUMN_ flags of the columns to sketch.
+ *  - sketches: filled with the sketches.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if a column is not in the model or 
+ *    allocation fails.
+ */
+static char sketch_model(people_model *model, unsigned char column_mask, people_sketches *sketches) {
+    sketch_job job;
+    unsigned int chunk_count = (model->count + SKETCH_CHUNK_ROWS - 1) / SKETCH_CHUNK_ROWS;
+    column_mask &= COLUMN_ALL;
+    if ((model->column_mask & column_mask) != column_mask) {
+        return 0;
+    }
+    model_require(model, column_mask, 0, model->count);
+
+    job.model = model;
+    job.column_mask = column_mask;
+    job.id_hashes = column_mask & COLUMN_ID ? hash_dictionary(&model->ids) : NULL;
+    job.name_hashes = column_mask & COLUMN_NAME ? hash_dictionary(&model->names) : NULL;
+    job.chunk_sketches = malloc(sizeof(people_sketches) * (chunk_count + 1));
+    if (job.chunk_sketches == NULL ||
+        (column_mask & COLUMN_ID && job.id_hashes == NULL) ||
+        (column_mask & COLUMN_NAME && job.name_hashes == NULL)) {
+        printf("Allocation fail [12]: could not sketch the model.");
+        free(job.id_hashes);
+        free(job.name_hashes);
+        free(job.chunk_sketches);
+        return 0;
+    }
+    run_parallel_tasks(chunk_count, sketch_model_task, &job);
+
+    sketches_init(sketches, column_mask);
+    for (unsigned int chunk = 0; chunk < chunk_count; ++chunk) {
+        sketches_merge(sketches, &job.chunk_sketches[chunk]);
+        deallocate_sketches(&job.chunk_sketches[chunk]);
+    }
+    free(job.id_hashes);
+    free(job.name_hashes);
+    free(job.chunk_sketches);
+    return 1;
+}
+
+/**
+ * Given the text of a mode, find if it is a sketch mode:
+ * "distinct " and ids, names, ages or weights, for the number of distinct
+ * values, or "p", a percentile from 0 to 100 and age or weight, for
+ * example "p95 age".
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - column: filled with the COLUMN_ flag of the column.
+ *  - percentile: filled with the percentile, or -1 for a distinct count.
+ * 
+ * return:
+ *  - returns 1 if the mode is a valid sketch mode and 0 if not.
+ */
+static char parse_sketch_mode(char *user_input, unsigned char *column, int *percentile) {
+    char *distinct_names[] = {"distinct ids", "distinct names", "distinct ages", "distinct weights"};
+    unsigned char columns[] = {COLUMN_ID, COLUMN_NAME, COLUMN_AGE, COLUMN_WEIGHT};
+    for (unsigned int i = 0; i < 4; ++i) {
+        if (string_compare(user_input, distinct_names[i])) {
+            *column = columns[i];
+            *percentile = -1;
+            return 1;
+        }
+    }
+
+    unsigned int index = 1;
+    if (user_input[0] != 'p' || user_input[1] < '0' || user_input[1] > '9') {
+        return 0;
+    }
+    *percentile = 0;
+    for (; user_input[index] >= '0' && user_input[index] <= '9' && *percentile <= 100; ++index) {
+        *percentile = *percentile * 10 + user_input[index] - '0';
+    }
+    if (*percentile > 100) {
+        return 0;
+    }
+    if (string_compare(user_input + index, " age")) {
+        *column = COLUMN_AGE;
+        return 1;
+    }
+    if (string_compare(user_input + index, " weight")) {
+        *column = COLUMN_WEIGHT;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Given a sketch mode and the sketches of the dataset, print the answer 
+ * of the mode with its error bound.
+ * 
+ * args:
+ *  - user_input: a mode accepted by `parse_sketch_mode`.
+ *  - sketches: the sketches, with the column of the mode.
+ * 
+ * return:
+ *  - returns 1 if the mode was run and 0 if there are no sketches.
+ */
+static char print_sketch_mode(char *user_input, people_sketches *sketches) {
+    unsigned char column;
+    int percentile;
+    if (sketches == NULL || sketches->count == 0 ||
+        !parse_sketch_mode(user_input, &column, &percentile)) {
+        return 0;
+    }
+
+    if (percentile < 0) {
+        unsigned int column_index = column == COLUMN_ID ? 0 : column == COLUMN_NAME ? 1 : column == COLUMN_AGE ? 2 : 3;
+        printf("There are about %.0f %s (within %0.2f%% at 95%% confidence)\n",
+               hll_estimate(&sketches->distinct[column_index]), user_input, 200 * HLL_ERROR);
+    } else {
+        kll_sketch *sketch = column == COLUMN_AGE ? &sketches->ages : &sketches->weights;
+        printf("The p%d %s is %u", percentile, strchr(user_input, ' ') + 1,
+               kll_quantile(sketch, percentile / 100.0));
+        if (sketch->compacted) {
+            printf(" (within %0.2f%% of the rank at 99%% confidence)\n", 100 * KLL_RANK_ERROR);
+        } else {
+            printf(" (exact)\n");
+        }
+    }
+    print_times(50, 2, "-");
+    return 1;
+}
+
+/**
+ * Given the text of a "where" clause, without the "where", parse it into a
+ * filter: comparisons of age or weight with a number, with one of
+ * <, <=, >, >=, = or !=, joined by "and" or "or". Spaces around the 
+ * operators are optional, for example "age > 40 and weight<70".
+ * A clause holds at most FILTER_MAX_TERMS comparisons.
+ * 
+ * args:
+ *  - clause: the text of the clause.
+ *  - filter: filled with the filter.
+ * 
+ * return:
+ *  - returns 1 if the clause is valid and 0 if not.
+ */
+static char parse_filter(char *clause, row_filter *filter) {
+    char *operators[] = {"<=", ">=", "!=", "<", ">", "="};
+    unsigned char operations[] = {
+        FILTER_LESS_EQUAL, FILTER_GREATER_EQUAL, FILTER_NOT_EQUAL,
+        FILTER_LESS, FILTER_GREATER, FILTER_EQUAL};
+    char *cursor = clause;
+    char or_before = 0;
+    filter->term_count = 0;
+    filter->column_mask = 0;
+
+    while (1) {
+        filter_term *term = &filter->terms[filter->term_count];
+        while (*cursor == ' ') {
+            ++cursor;
+        }
+        if (string_starts_with(cursor, "age")) {
+            term->column = COLUMN_AGE;
+            cursor += 3;
+        } else if (string_starts_with(cursor, "weight")) {
+            term->column = COLUMN_WEIGHT;
+            cursor += 6;
+        } else {
+            return 0;
+        }
+        while (*cursor == ' ') {
+            ++cursor;
+        }
+
+        unsigned int operator_index = 0;
+        while (operator_index < 6 && !string_starts_with(cursor, operators[operator_index])) {
+            ++operator_index;
+        }
+        if (operator_index == 6) {
+            return 0;
+        }
+        term->operation = operations[operator_index];
+        cursor += string_length(operators[operator_index]);
+        while (*cursor == ' ') {
+            ++cursor;
+        }
+
+        if (*cursor < '0' || *cursor > '9') {
+            return 0;
+        }
+        unsigned long value = 0;
+        for (; *cursor >= '0' && *cursor <= '9'; ++cursor) {
+            value = value * 10 + (*cursor - '0');
+            if (value > 0xFFFFFFFFUL) {
+                return 0;
+            }
+        }
+        term->value = value;
+        term->or_before = or_before;
+        filter->column_mask |= term->column;
+        ++filter->term_count;
+
+        while (*cursor == ' ') {
+            ++cursor;
+        }
+        if (*cursor == '\0') {
+            return 1;
+        }
+        if (filter->term_count == FILTER_MAX_TERMS) {
+            return 0;
+        }
+        if (string_starts_with(cursor, "and ")) {
+            or_before = 0;
+            cursor += 4;
+        } else if (string_starts_with(cursor, "or ")) {
+            or_before = 1;
+            cursor += 3;
+        } else {
+            return 0;
+        }
+    }
+}
+
+/**
+ * Given a column of values, a comparison and a value, set the bit of every
+ * row whose value passes the comparison in a bitmap, 64 rows per word.
+ * 
+ * Full words are compared 4 values at a time with SSE2 when the compiler
+ * targets it and one value at a time otherwise. SSE2 only compares signed
+ * ints, so the sign bits are flipped first to compare unsigned ones.
+ * <=, >= and != are found as the complement of >, < and =.
+ * 
+ * args:
+ *  - values: the column.
+ *  - count: the number of rows.
+ *  - operation: one of the FILTER_ comparisons.
+ *  - value: the value to compare with.
+ *  - bitmap: filled with (count + 63) / 64 words.
+ */
+static void filter_column_bitmap(
+    unsigned int *values,
+    unsigned int count,
+    unsigned char operation,
+    unsigned int value,
+    unsigned long *bitmap) {
+
+    char negate = operation == FILTER_LESS_EQUAL || operation == FILTER_GREATER_EQUAL ||
+                  operation == FILTER_NOT_EQUAL;
+    unsigned char base_operation =
+        operation == FILTER_LESS_EQUAL ? FILTER_GREATER :
+        operation == FILTER_GREATER_EQUAL ? FILTER_LESS :
+        operation == FILTER_NOT_EQUAL ? FILTER_EQUAL : operation;
+    unsigned int word_count = (count + 63) / 64;
+#ifdef __SSE2__
+    __m128i sign_bits = _mm_set1_epi32((int)0x80000000u);
+    __m128i compared = _mm_xor_si128(_mm_set1_epi32((int)value), sign_bits);
+#endif
+
+    for (unsigned int word = 0; word < word_count; ++word) {
+        unsigned int begin = word * 64;
+        unsigned int end = begin + 64 < count ? begin + 64 : count;
+        unsigned long bits = 0;
+#ifdef __SSE2__
+        if (end - begin == 64) {
+            for (unsigned int offset = 0; offset < 64; offset += 4) {
+                __m128i loaded = _mm_xor_si128(
+                    _mm_loadu_si128((__m128i *)(values + begin + offset)), sign_bits);
+                __m128i passed =
+                    base_operation == FILTER_LESS ? _mm_cmplt_epi32(loaded, compared) :
+                    base_operation == FILTER_GREATER ? _mm_cmpgt_epi32(loaded, compared) :
+                    _mm_cmpeq_epi32(loaded, compared);
+                bits |= (unsigned long)_mm_movemask_ps(_mm_castsi128_ps(passed)) << offset;
+            }
+        } else
+#endif
+        {
+            for (unsigned int row = begin; row < end; ++row) {
+                char passed =
+                    base_operation == FILTER_LESS ? values[row] < value :
+                    base_operation == FILTER_GREATER ? values[row] > value :
+                    values[row] == value;
+                bits |= (unsigned long)passed << (row - begin);
+            }
+        }
+        if (negate) {
+            bits = ~bits;
+            if (end - begin < 64) {
+                bits &= (1UL << (end - begin)) - 1;
+            }
+        }
+        bitmap[word] = bits;
+    }
+}
+
+/**
+ * Given a comparison and the smallest and largest value of a zone, find
+ * whether all, none or only some of the rows of the zone can pass it.
+ * 
+ * return:
+ *  - FILTER_ZONE_ALL, FILTER_ZONE_NONE or FILTER_ZONE_SOME.
+ */
+static char get_zone_outcome(filter_term *term, unsigned int smallest, unsigned int largest) {
+    unsigned int value = term->value;
+    switch (term->operation) {
+        case FILTER_LESS:
+            return largest < value ? FILTER_ZONE_ALL : smallest >= value ? FILTER_ZONE_NONE : FILTER_ZONE_SOME;
+        case FILTER_LESS_EQUAL:
+            return largest <= value ? FILTER_ZONE_ALL : smallest > value ? FILTER_ZONE_NONE : FILTER_ZONE_SOME;
+        case FILTER_GREATER:
+            return smallest > value ? FILTER_ZONE_ALL : largest <= value ? FILTER_ZONE_NONE : FILTER_ZONE_SOME;
+        case FILTER_GREATER_EQUAL:
+            return smallest >= value ? FILTER_ZONE_ALL : largest < value ? FILTER_ZONE_NONE : FILTER_ZONE_SOME;
+        case FILTER_EQUAL:
+            return smallest == value && largest == value ? FILTER_ZONE_ALL :
+                   value < smallest || value > largest ? FILTER_ZONE_NONE : FILTER_ZONE_SOME;
+        case FILTER_NOT_EQUAL:
+            return value < smallest || value > largest ? FILTER_ZONE_ALL :
+                   smallest == value && largest == value ? FILTER_ZONE_NONE : FILTER_ZONE_SOME;
+    }
+    return FILTER_ZONE_SOME;
+}
+
+/**
+ * Given a model and a filter, find the rows that pass the filter as a 
+ * bitmap, 64 rows per word.
+ * 
+ * Each comparison is evaluated over its whole column into a bitmap, the 
+ * bitmaps of comparisons joined by "and" are intersected word by word and
+ * the groups joined by "or" are united.
+ * 
+ * Zones of the column whose zone map shows that all or none of their rows
+ * pass are filled without reading their values, and so are the zones of a
+ * comparison joined by "and" where no row passed the comparisons before it.
+ * Empty cells pass no comparison.
+ * 
+ * NOTE: the returned bitmap must be freed.
+ * 
+ * args:
+ *  - model: the model. The columns of the filter are decoded if they are not yet.
+ *  - filter: the filter.
+ * 
+ * return:
+ *  - the (model->count + 63) / 64 words of the bitmap, or NULL if allocation fails.
+ */
+static unsigned long *filter_model_bitmap(people_model *model, row_filter *filter) {
+    unsigned int word_count = (model->count + 63) / 64;
+    unsigned long *result = calloc(word_count + 1, sizeof(unsigned long));
+    unsigned long *group = malloc(sizeof(unsigned long) * (word_count + 1));
+    unsigned long *term_bits = malloc(sizeof(unsigned long) * (word_count + 1));
+    if (result == NULL || group == NULL || term_bits == NULL) {
+        printf("Allocation fail [13]: could not filter the rows.");
+        free(result);
+        result = NULL;
+        goto after_filter;
+    }
+    model_require(model, filter->column_mask, 0, model->count);
+
+    for (unsigned int index = 0; index < filter->term_count; ++index) {
+        filter_term *term = &filter->terms[index];
+        unsigned int *values = term->column == COLUMN_AGE ? model->ages : model->weights;
+        unsigned long *bitmap = index == 0 || term->or_before ? group : term_bits;
+        zone_map *zones = model_zone_map(model, term->column);
+        for (unsigned int zone = 0; zone * ZONE_ROWS < model->count; ++zone) {
+            unsigned int begin = zone * ZONE_ROWS;
+            unsigned int end = begin + ZONE_ROWS < model->count ? begin + ZONE_ROWS : model->count;
+            unsigned int first_word = begin / 64;
+            unsigned int end_word = (end + 63) / 64;
+            char outcome = zone >= zones->zone_count ? FILTER_ZONE_SOME :
+                zones->null_counts[zone] == zones->row_counts[zone] ? FILTER_ZONE_NONE :
+                get_zone_outcome(term, zones->minimums[zone], zones->maximums[zone]);
+            if (bitmap == term_bits && outcome != FILTER_ZONE_NONE) {
+                unsigned long group_bits = 0;
+                for (unsigned int word = first_word; word < end_word; ++word) {
+                    group_bits |= group[word];
+                }
+                outcome = group_bits == 0 ? FILTER_ZONE_NONE : outcome;
+            }
+            if (outcome == FILTER_ZONE_SOME) {
+                filter_column_bitmap(values + begin, end - begin, term->operation, term->value,
+                                     bitmap + first_word);
+            } else {
+                for (unsigned int word = first_word; word < end_word; ++word) {
+                    bitmap[word] = outcome == FILTER_ZONE_ALL ? ~0UL : 0;
+                }
+                if (outcome == FILTER_ZONE_ALL && end % 64 != 0) {
+                    bitmap[end_word - 1] = (1UL << (end % 64)) - 1;
+                }
+            }
+            if (outcome != FILTER_ZONE_NONE && zone < zones->zone_count && zones->null_counts[zone] > 0) {
+                for (unsigned int word = first_word; word < end_word; ++word) {
+                    bitmap[word] &= ~zones->null_rows[word];
+                }
+            }
+        }
+        if (index > 0 && !term->or_before) {
+            for (unsigned int word = 0; word < word_count; ++word) {
+                group[word] &= term_bits[word];
+            }
+        }
+        if (index + 1 == filter->term_count || filter->terms[index + 1].or_before) {
+            for (unsigned int word = 0; word < word_count; ++word) {
+                result[word] |= group[word];
+            }
+        }
+    }
+
+after_filter:
+    free(group);
+    free(term_bits);
+    return result;
+}
+
+/**
+ * Given a model and a filter, find the rows that pass the filter: the 
+ * bitmap of `filter_model_bitmap` turned into a selection vector, the 
+ * passing rows in order.
+ * 
+ * NOTE: the returned array must be freed.
+ * 
+ * args:
+ *  - model: the model. The columns of the filter are decoded if they are not yet.
+ *  - filter: the filter.
+ *  - selected_count: filled with the number of passing rows.
+ * 
+ * return:
+ *  - the passing rows, or NULL if allocation fails.
+ */
+static unsigned int *filter_model_rows(people_model *model, row_filter *filter, unsigned int *selected_count) {
+    unsigned int word_count = (model->count + 63) / 64;
+    unsigned long *result = filter_model_bitmap(model, filter);
+    unsigned int *rows = NULL;
+    *selected_count = 0;
+    if (result == NULL) {
+        return NULL;
+    }
+
+    unsigned int count = 0;
+    for (unsigned int word = 0; word < word_count; ++word) {
+        for (unsigned long bits = result[word]; bits != 0; bits &= bits - 1) {
+            ++count;
+        }
+    }
+    rows = malloc(sizeof(unsigned int) * (count + 1));
+    if (rows == NULL) {
+        printf("Allocation fail [13]: could not filter the rows.");
+        free(result);
+        return NULL;
+    }
+    for (unsigned int word = 0; word < word_count; ++word) {
+        unsigned long bits = result[word];
+        for (unsigned int bit = 0; bits != 0; ++bit, bits >>= 1) {
+            if (bits & 1) {
+                rows[(*selected_count)++] = word * 64 + bit;
+            }
+        }
+    }
+    free(result);
+    return rows;
+}
+
+/**
+ * Given the text of a mode, find if it has a "where" clause and split it
+ * off: the mode before " where " is copied into `mode` and `clause` 
+ * points after it in the copy.
+ * 
+ * args:
+ *  - user_input: the mode typed by the user. It is not changed.
+ *  - mode: a buffer of 261 characters, filled with the copy.
+ *  - clause: filled with the clause, without the "where".
+ * 
+ * return:
+ *  - returns 1 if the mode had a clause and 0 if not.
+ */
+static char split_where_clause(char *user_input, char *mode, char **clause) {
+    snprintf(mode, 261, "%s", user_input);
+    char *where = strstr(mode, " where ");
+    if (where == NULL) {
+        return 0;
+    }
+    *where = '\0';
+    *clause = where + 7;
+    return 1;
+}
+
+/**
+ * Given a flat builder and a number of chars, make room for them after its
+ * data. The room is filled with zeros.
+ */
+static void flat_reserve(flat_builder *builder, unsigned long length) {
+    if (builder->length + length > builder->capacity) {
+        unsigned long capacity = builder->capacity == 0 ? 256 : builder->capacity;
+        while (builder->length + length > capacity) {
+            capacity *= 2;
+        }
+        unsigned char *data = realloc(builder->data, capacity);
+        if (data == NULL) {
+            printf("Allocation fail [16]: could not build the Arrow metadata.");
+            builder->failed = 1;
+            return;
+        }
+        builder->data = data;
+        builder->capacity = capacity;
+    }
+    memset(builder->data + builder->length, 0, length);
+    builder->length += length;
+}
+
+/**
+ * Given a flat builder, append zeros until `length + extra` is a multiple 
+ * of `alignment`.
+ */
+static void flat_pad(flat_builder *builder, unsigned long alignment, unsigned long extra) {
+    unsigned long padding = (alignment - (builder->length + extra) % alignment) % alignment;
+    flat_reserve(builder, padding);
+}
+
+/**
+ * Given a flat builder, write `size` chars of a value at a position of its
+ * data. Numbers are written in the byte order of the machine, which must be
+ * little endian as flatbuffers are.
+ */
+static void flat_set(flat_builder *builder, unsigned long position, void *value, unsigned int size) {
+    if (!builder->failed) {
+        memcpy(builder->data + position, value, size);
+    }
+}
+
+/**
+ * Given a flat builder, the position of an offset field and the position of
+ * the object it refers to, which must come after it, fill the field.
+ */
+static void flat_link(flat_builder *builder, unsigned long field, unsigned long target) {
+    unsigned int offset = target - field;
+    flat_set(builder, field, &offset, 4);
+}
+
+/**
+ * Given a flat builder and the sizes of the fields of a table, where 0 means
+ * the field is absent, append the vtable and the zeroed table.
+ * 
+ * args:
+ *  - slot_count: the number of fields.
+ *  - sizes: the size of every field, 1, 2, 4 or 8, or 0.
+ *  - fields: filled with the position of every field, to be set with
+ *            `flat_set` or `flat_link`.
+ * 
+ * return:
+ *  - the position of the table.
+ */
+static unsigned long flat_table(flat_builder *builder, unsigned int slot_count, unsigned char *sizes, unsigned long *fields) {
+    unsigned short vtable_size = 4 + 2 * slot_count;
+    flat_pad(builder, 2, 0);
+    unsigned long vtable = builder->length;
+    flat_reserve(builder, vtable_size);
+    flat_pad(builder, 8, 0);
+    unsigned long table = builder->length;
+
+    unsigned long cursor = table + 4;
+    for (unsigned int slot = 0; slot < slot_count; ++slot) {
+        unsigned short field_offset = 0;
+        fields[slot] = 0;
+        if (sizes[slot] != 0) {
+            cursor += (sizes[slot] - cursor % sizes[slot]) % sizes[slot];
+            fields[slot] = cursor;
+            field_offset = cursor - table;
+            cursor += sizes[slot];
+        }
+        flat_set(builder, vtable + 4 + 2 * slot, &field_offset, 2);
+    }
+    flat_reserve(builder, cursor - table);
+
+    unsigned short table_size = cursor - table;
+    int vtable_offset = table - vtable;
+    flat_set(builder, vtable, &vtable_size, 2);
+    flat_set(builder, vtable + 2, &table_size, 2);
+    flat_set(builder, table, &vtable_offset, 4);
+    return table;
+}
+
+/**
+ * Given a flat builder, append a zeroed vector of `count` elements of
+ * `element_size` chars whose first element is aligned to `alignment`.
+ * 
+ * return:
+ *  - the position of the vector. Its elements start 4 chars after it.
+ */
+static unsigned long flat_vector(flat_builder *builder, unsigned int count, unsigned int element_size, unsigned int alignment) {
+    flat_pad(builder, alignment < 4 ? 4 : alignment, 4);
+    unsigned long vector = builder->length;
+    flat_reserve(builder, 4 + (unsigned long)count * element_size);
+    flat_set(builder, vector, &count, 4);
+    return vector;
+}
+
+/**
+ * Given a flat builder, append a null terminated string.
+ * 
+ * return:
+ *  - the position of the string.
+ */
+static unsigned long flat_string(flat_builder *builder, char *text) {
+    unsigned int length = string_length(text);
+    flat_pad(builder, 4, 0);
+    unsigned long string = builder->length;
+    flat_reserve(builder, 4 + length + 1);
+    flat_set(builder, string, &length, 4);
+    flat_set(builder, string + 4, text, length);
+    return string;
+}
+
+/**
+ * Given a flat builder, append an Arrow Schema table of the four columns
+ * of a people_model: id and name as utf8 and age and weight as uint32.
+ * 
+ * return:
+ *  - the position of the Schema table.
+ */
+static unsigned long write_arrow_schema(flat_builder *builder) {
+    char *names[] = {"id", "name", "age", "weight"};
+    unsigned char schema_sizes[] = {0, 4};
+    unsigned char field_sizes[] = {4, 1, 1, 4, 0, 4};
+    unsigned char int_sizes[] = {4, 1};
+    unsigned long schema_fields[2];
+    unsigned long fields[6];
+    unsigned long int_fields[2];
+
+    unsigned long schema = flat_table(builder, 2, schema_sizes, schema_fields);
+    unsigned long vector = flat_vector(builder, 4, 4, 4);
+    flat_link(builder, schema_fields[1], vector);
+    for (unsigned int column = 0; column < 4; ++column) {
+        unsigned char nullable = 1;
+        unsigned char type = column < 2 ? ARROW_TYPE_UTF8 : ARROW_TYPE_INT;
+        unsigned long field = flat_table(builder, 6, field_sizes, fields);
+        flat_link(builder, vector + 4 + 4 * column, field);
+        flat_link(builder, fields[0], flat_string(builder, names[column]));
+        flat_set(builder, fields[1], &nullable, 1);
+        flat_set(builder, fields[2], &type, 1);
+        if (column < 2) {
+            flat_link(builder, fields[3], flat_table(builder, 0, NULL, NULL));
+        } else {
+            int bit_width = 32;
+            unsigned char is_signed = 0;
+            flat_link(builder, fields[3], flat_table(builder, 2, int_sizes, int_fields));
+            flat_set(builder, int_fields[0], &bit_width, 4);
+            flat_set(builder, int_fields[1], &is_signed, 1);
+        }
+        flat_link(builder, fields[5], flat_vector(builder, 0, 4, 4));
+    }
+    return schema;
+}
+
+/**
+ * Given a flat builder holding a whole flatbuffer and an open file, write
+ * it as an encapsulated Arrow message: a continuation marker, the length of
+ * the flatbuffer padded to 8 chars and the padded flatbuffer.
+ * 
+ * return:
+ *  - the number of chars written, or 0 on a write error.
+ */
+static unsigned long write_arrow_metadata(FILE *output_file, flat_builder *builder) {
+    unsigned int continuation = ARROW_CONTINUATION;
+    flat_pad(builder, 8, 0);
+    int length = builder->length;
+    if (builder->failed || fwrite(&continuation, 4, 1, output_file) != 1 ||
+        fwrite(&length, 4, 1, output_file) != 1 ||
+        fwrite(builder->data, 1, builder->length, output_file) != builder->length) {
+        return 0;
+    }
+    return 8 + builder->length;
+}
+
+/**
+ * The buffers of the body of one record batch of an Arrow export: where
+ * each buffer starts in the body and how long it is, the number of null
+ * values of each column, and the text of the buffers that are not columns 
+ * of the model as they are (the offsets and data of the id and name 
+ * strings, the validity bitmaps and the selected values). 
+ * `copied_values` is 1 if the values of age and weight were copied too.
+*/
+typedef struct _arrow_batch {
+
+    unsigned int row_count;
+    unsigned long offsets[ARROW_BUFFER_COUNT];
+    unsigned long lengths[ARROW_BUFFER_COUNT];
+    char *buffers[ARROW_BUFFER_COUNT];
+    unsigned long null_counts[4];
+    unsigned long body_length;
+    char copied_values;
+} arrow_batch;
+
+/**
+ * Given a model, its table if it has one and some rows, fill an arrow_batch
+ * with the buffers of those rows.
+ * 
+ * The buffers of each column are, in order: id and name have a validity 
+ * bitmap, left empty as their strings are never null, int32 offsets and 
+ * the chars of the strings. Age and weight have a validity bitmap, empty if
+ * none of their cells are, and the values. Values of consecutive rows are 
+ * not copied: the buffer points into the model.
+ * 
+ * args:
+ *  - batch: the batch to fill. Its buffers must be freed with `deallocate_arrow_batch`.
+ *  - model: the model, with every column decoded.
+ *  - table: the table of the model, used to find empty cells, or NULL.
+ *  - rows: the rows to export, or NULL for the rows from `first_row` on.
+ *  - first_row: the index of the first row of the batch in `rows`, or in the model.
+ *  - row_count: the number of rows of the batch.
+ */
+static void fill_arrow_batch(
+    arrow_batch *batch,
+    people_model *model,
+    string_mat *table,
+    unsigned int *rows,
+    unsigned int first_row,
+    unsigned int row_count) {
+
+    unsigned long bitmap_length = (row_count + 7) / 8;
+    batch->row_count = row_count;
+    batch->body_length = 0;
+    batch->copied_values = rows != NULL;
+    for (unsigned int i = 0; i < ARROW_BUFFER_COUNT; ++i) {
+        batch->buffers[i] = NULL;
+        batch->lengths[i] = 0;
+    }
+
+    for (unsigned int column = 0; column < 2; ++column) {
+        string_dict *dict = column == 0 ? &model->ids : &model->names;
+        unsigned int *codes = column == 0 ? model->id_codes : model->name_codes;
+        int *offsets = malloc(sizeof(int) * (row_count + 1));
+        string_builder data;
+        data.length = 0;
+        data.capacity = STREAM_BLOCK_SIZE;
+        data.string = allocate_string(data.capacity);
+        data.scan = NULL;
+        offsets[0] = 0;
+        for (unsigned int i = 0; i < row_count; ++i) {
+            unsigned int row = rows == NULL ? first_row + i : rows[first_row + i];
+            char *value = string_dict_get(dict, codes[row]);
+            append_block(&data, value, string_length(value));
+            offsets[i + 1] = data.length;
+        }
+        batch->null_counts[column] = 0;
+        batch->buffers[3 * column + 1] = (char *)offsets;
+        batch->lengths[3 * column + 1] = sizeof(int) * (row_count + 1);
+        batch->buffers[3 * column + 2] = data.string;
+        batch->lengths[3 * column + 2] = data.length;
+    }
+
+    for (unsigned int column = 2; column < 4; ++column) {
+        unsigned int *values = column == 2 ? model->ages : model->weights;
+        unsigned char *validity = calloc(bitmap_length + 1, 1);
+        unsigned int buffer = column == 2 ? ARROW_AGE_VALUES - 1 : ARROW_WEIGHT_VALUES - 1;
+        batch->null_counts[column] = 0;
+        for (unsigned int i = 0; i < row_count; ++i) {
+            unsigned int row = rows == NULL ? first_row + i : rows[first_row + i];
+            char empty = table != NULL &&
+                cell_length(table_data_cell(*table, row, column), table->cell_size[0]) == 0;
+            batch->null_counts[column] += empty;
+            validity[i / 8] |= !empty << (i % 8);
+        }
+        if (batch->null_counts[column] > 0) {
+            batch->buffers[buffer] = (char *)validity;
+            batch->lengths[buffer] = bitmap_length;
+        } else {
+            free(validity);
+        }
+
+        if (rows == NULL) {
+            batch->buffers[buffer + 1] = (char *)(values + first_row);
+        } else {
+            unsigned int *selected = allocate_unsigned_int(row_count + 1);
+            for (unsigned int i = 0; i < row_count; ++i) {
+                selected[i] = values[rows[first_row + i]];
+            }
+            batch->buffers[buffer + 1] = (char *)selected;
+        }
+        batch->lengths[buffer + 1] = sizeof(unsigned int) * row_count;
+    }
+
+    for (unsigned int i = 0; i < ARROW_BUFFER_COUNT; ++i) {
+        batch->offsets[i] = batch->body_length;
+        batch->body_length += (batch->lengths[i] + 7) / 8 * 8;
+    }
+}
+
+/**
+ * Given an arrow_batch filled by `fill_arrow_batch`, free the buffers it
+ * allocated.
+ */
+static void deallocate_arrow_batch(arrow_batch *batch) {
+    for (unsigned int i = 0; i < ARROW_BUFFER_COUNT; ++i) {
+        if (batch->copied_values || (i != ARROW_AGE_VALUES && i != ARROW_WEIGHT_VALUES)) {
+            free(batch->buffers[i]);
+        }
+    }
+}
+
+/**
+ * Given an arrow_batch and an open file, write the RecordBatch message of 
+ * the batch and then its body.
+ * 
+ * return:
+ *  - the length of the metadata of the message, or 0 on a write error.
+ */
+static unsigned long write_arrow_batch(FILE *output_file, arrow_batch *batch) {
+    flat_builder builder = {NULL, 0, 0, 0};
+    unsigned char message_sizes[] = {2, 1, 4, 8};
+    unsigned char batch_sizes[] = {8, 4, 4};
+    unsigned long message_fields[4];
+    unsigned long batch_fields[3];
+    short version = ARROW_METADATA_V5;
+    unsigned char header_type = ARROW_HEADER_RECORD_BATCH;
+    long row_count = batch->row_count;
+    long body_length = batch->body_length;
+    char padding[8] = {0};
+
+    flat_reserve(&builder, 4);
+    unsigned long message = flat_table(&builder, 4, message_sizes, message_fields);
+    flat_link(&builder, 0, message);
+    flat_set(&builder, message_fields[0], &version, 2);
+    flat_set(&builder, message_fields[1], &header_type, 1);
+    flat_set(&builder, message_fields[3], &body_length, 8);
+    unsigned long record_batch = flat_table(&builder, 3, batch_sizes, batch_fields);
+    flat_link(&builder, message_fields[2], record_batch);
+    flat_set(&builder, batch_fields[0], &row_count, 8);
+
+    unsigned long nodes = flat_vector(&builder, 4, 16, 8);
+    flat_link(&builder, batch_fields[1], nodes);
+    for (unsigned int column = 0; column < 4; ++column) {
+        flat_set(&builder, nodes + 4 + 16 * column, &row_count, 8);
+        flat_set(&builder, nodes + 4 + 16 * column + 8, &batch->null_counts[column], 8);
+    }
+    unsigned long buffers = flat_vector(&builder, ARROW_BUFFER_COUNT, 16, 8);
+    flat_link(&builder, batch_fields[2], buffers);
+    for (unsigned int i = 0; i < ARROW_BUFFER_COUNT; ++i) {
+        flat_set(&builder, buffers + 4 + 16 * i, &batch->offsets[i], 8);
+        flat_set(&builder, buffers + 4 + 16 * i + 8, &batch->lengths[i], 8);
+    }
+
+    unsigned long metadata_length = write_arrow_metadata(output_file, &builder);
+    free(builder.data);
+    for (unsigned int i = 0; metadata_length > 0 && i < ARROW_BUFFER_COUNT; ++i) {
+        if (fwrite(batch->buffers[i], 1, batch->lengths[i], output_file) != batch->lengths[i] ||
+            fwrite(padding, 1, (8 - batch->lengths[i] % 8) % 8, output_file) != (8 - batch->lengths[i] % 8) % 8) {
+            return 0;
+        }
+    }
+    return metadata_length;
+}
+
+/**
+ * Given a model and the path of a file, write the people of the model to
+ * the file in the Arrow IPC file format, so other tools can map the columns
+ * without parsing text.
+ * 
+ * The file holds the "ARROW1" magic, the schema, one record batch per 
+ * ARROW_BATCH_ROWS rows written as they are built, the end of stream marker
+ * and the footer that locates the batches.
+ * 
+ * args:
+ *  - model: the model. Every column is decoded here if it is not yet.
+ *  - table: the table of the model, used to mark empty age and weight
+ *           cells as null, or NULL.
+ *  - rows: the rows to export, or NULL for all the rows.
+ *  - row_count: the number of rows in `rows`. Ignored if `rows` is NULL.
+ *  - path: the path of the file to write.
+ *  - batch_count: filled with the number of record batches written.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the file could not be written.
+ */
+static char export_model_arrow(
+    people_model *model,
+    string_mat *table,
+    unsigned int *rows,
+    unsigned int row_count,
+    char *path,
+    unsigned int *batch_count) {
+
+    FILE *output_file = fopen(path, "wb");
+    flat_builder builder = {NULL, 0, 0, 0};
+    flat_builder footer = {NULL, 0, 0, 0};
+    unsigned char message_sizes[] = {2, 1, 4, 8};
+    unsigned char footer_sizes[] = {2, 4, 4, 4};
+    unsigned long fields[4];
+    short version = ARROW_METADATA_V5;
+    unsigned char header_type = ARROW_HEADER_SCHEMA;
+    unsigned int end_of_stream[2] = {ARROW_CONTINUATION, 0};
+    char success = 0;
+
+    if (output_file == NULL) {
+        printf("Could not open %s for writing.\n", path);
+        return 0;
+    }
+    model_require(model, COLUMN_ALL, 0, model->count);
+    row_count = rows == NULL ? model->count : row_count;
+    *batch_count = (row_count + ARROW_BATCH_ROWS - 1) / ARROW_BATCH_ROWS;
+    long *block_offsets = malloc(sizeof(long) * (*batch_count + 1));
+    long *block_metadata = malloc(sizeof(long) * (*batch_count + 1));
+    long *block_bodies = malloc(sizeof(long) * (*batch_count + 1));
+    if (block_offsets == NULL || block_metadata == NULL || block_bodies == NULL) {
+        printf("Allocation fail [16]: could not export the rows.");
+        goto after_export;
+    }
+
+    flat_reserve(&builder, 4);
+    unsigned long message = flat_table(&builder, 4, message_sizes, fields);
+    flat_link(&builder, 0, message);
+    flat_set(&builder, fields[0], &version, 2);
+    flat_set(&builder, fields[1], &header_type, 1);
+    flat_link(&builder, fields[2], write_arrow_schema(&builder));
+    if (fwrite(ARROW_MAGIC "\0\0", 1, 8, output_file) != 8 ||
+        write_arrow_metadata(output_file, &builder) == 0) {
+        goto after_export;
+    }
+
+    unsigned long position = 8 + 8 + builder.length;
+    for (unsigned int batch_index = 0; batch_index < *batch_count; ++batch_index) {
+        arrow_batch batch;
+        unsigned int first_row = batch_index * ARROW_BATCH_ROWS;
+        fill_arrow_batch(&batch, model, table, rows, first_row,
+                         row_count - first_row < ARROW_BATCH_ROWS ? row_count - first_row : ARROW_BATCH_ROWS);
+        unsigned long metadata_length = write_arrow_batch(output_file, &batch);
+        deallocate_arrow_batch(&batch);
+        if (metadata_length == 0) {
+            goto after_export;
+        }
+        block_offsets[batch_index] = position;
+        block_metadata[batch_index] = metadata_length;
+        block_bodies[batch_index] = batch.body_length;
+        position += metadata_length + batch.body_length;
+    }
+    if (fwrite(end_of_stream, 4, 2, output_file) != 2) {
+        goto after_export;
+    }
+
+    flat_reserve(&footer, 4);
+    unsigned long footer_table = flat_table(&footer, 4, footer_sizes, fields);
+    flat_link(&footer, 0, footer_table);
+    flat_set(&footer, fields[0], &version, 2);
+    flat_link(&footer, fields[1], write_arrow_schema(&footer));
+    flat_link(&footer, fields[2], flat_vector(&footer, 0, 24, 8));
+    unsigned long blocks = flat_vector(&footer, *batch_count, 24, 8);
+    flat_link(&footer, fields[3], blocks);
+    for (unsigned int i = 0; i < *batch_count; ++i) {
+        int metadata_length = block_metadata[i];
+        flat_set(&footer, blocks + 4 + 24 * i, &block_offsets[i], 8);
+        flat_set(&footer, blocks + 4 + 24 * i + 8, &metadata_length, 4);
+        flat_set(&footer, blocks + 4 + 24 * i + 16, &block_bodies[i], 8);
+    }
+    int footer_length = footer.length;
+    success = !footer.failed &&
+              fwrite(footer.data, 1, footer.length, output_file) == footer.length &&
+              fwrite(&footer_length, 4, 1, output_file) == 1 &&
+              fwrite(ARROW_MAGIC, 1, 6, output_file) == 6;
+
+after_export:
+    if (fclose(output_file) != 0) {
+        success = 0;
+    }
+    if (!success) {
+        printf("Could not write %s.\n", path);
+    }
+    free(builder.data);
+    free(footer.data);
+    free(block_offsets);
+    free(block_metadata);
+    free(block_bodies);
+    return success;
+}
+
+/**
+ * Given the text of a mode, find if it is an export mode,
+ * "export arrow <path>", and if so copy its path.
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - path: a buffer of 261 characters, filled with the path.
+ * 
+ * return:
+ *  - returns 1 if the mode is an export mode and 0 if not.
+ */
+static char parse_export_mode(char *user_input, char *path) {
+    if (!string_starts_with(user_input, "export arrow ") || user_input[13] == '\0' ||
+        string_length(user_input + 13) > 260) {
+        return 0;
+    }
+    snprintf(path, 261, "%s", user_input + 13);
+    return 1;
+}
+
+/**
+ * Given a dictionary of names and the count, age sum and weight sum of the
+ * people of each code, print a line per name in the order of the codes.
+ */
+static void print_group_lines(
+    string_dict *names,
+    unsigned int *counts,
+    unsigned long *age_sums,
+    unsigned long *weight_sums) {
+
+    for (unsigned int code = 0; code < names->count; ++code) {
+        printf("%s: %u people, average age %0.2f, average weight %0.2f\n",
+               string_dict_get(names, code), counts[code],
+               age_sums[code] * 1.0f / counts[code],
+               weight_sums[code] * 1.0f / counts[code]);
+    }
+}
+
+/**
+ * Given a model, print the number of people and their average age and 
+ * weight for every distinct name, in the order the names first appear.
+ * People are grouped by their name code, so no names are compared.
+ * 
+ * args:
+ *  - model: the model to group.
+ */
+static void print_name_groups(people_model *model) {
+    unsigned int group_count = model->names.count;
+    unsigned int *counts = calloc(group_count, sizeof(unsigned int));
+    unsigned long *age_sums = calloc(group_count, sizeof(unsigned long));
+    unsigned long *weight_sums = calloc(group_count, sizeof(unsigned long));
+    if (counts == NULL || age_sums == NULL || weight_sums == NULL) {
+        printf("Allocation fail [8]: could not group the names.");
+        free(counts);
+        free(age_sums);
+        free(weight_sums);
+        return;
+    }
+
+    for (unsigned int row = 0; row < model->count; ++row) {
+        unsigned int code = model->name_codes[row];
+        ++counts[code];
+        age_sums[code] += model->ages[row];
+        weight_sums[code] += model->weights[row];
+    }
+    print_group_lines(&model->names, counts, age_sums, weight_sums);
+    free(counts);
+    free(age_sums);
+    free(weight_sums);
+}
+
+/**
+ * Given the text of a mode, find if it is an "update" mode:
+ * "update", age or weight, "+=", "-=" or "=" and a number, then optionally
+ * "where" and a clause. The clause is a filter (see `parse_filter`) or 
+ * "id in" and the path of a file with one id per line.
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - update: filled with the column, the operation, the operand and the
+ *            clause. No row is selected yet, see `select_update_rows`.
+ * 
+ * return:
+ *  - returns 1 if the mode is a valid update mode and 0 if not.
+ */
+static char parse_update_mode(char *user_input, column_update *update) {
+    char *operators[] = {"+=", "-=", "="};
+    unsigned char operations[] = {UPDATE_ADD, UPDATE_SUBTRACT, UPDATE_SET};
+    row_filter filter;
+    unsigned int operator_index = 0;
+    unsigned long operand = 0;
+
+    update->selected = NULL;
+    update->selected_count = 0;
+    if (!split_where_clause(user_input, update->mode, &update->clause)) {
+        update->clause = NULL;
+    }
+    char *cursor = update->mode;
+    if (!string_starts_with(cursor, "update ")) {
+        return 0;
+    }
+    cursor += 7;
+    if (string_starts_with(cursor, "age")) {
+        update->column = COLUMN_AGE;
+        cursor += 3;
+    } else if (string_starts_with(cursor, "weight")) {
+        update->column = COLUMN_WEIGHT;
+        cursor += 6;
+    } else {
+        return 0;
+    }
+    while (*cursor == ' ') {
+        ++cursor;
+    }
+    while (operator_index < 3 && !string_starts_with(cursor, operators[operator_index])) {
+        ++operator_index;
+    }
+    if (operator_index == 3) {
+        return 0;
+    }
+    update->operation = operations[operator_index];
+    cursor += string_length(operators[operator_index]);
+    while (*cursor == ' ') {
+        ++cursor;
+    }
+
+    if (*cursor < '0' || *cursor > '9') {
+        return 0;
+    }
+    for (; *cursor >= '0' && *cursor <= '9'; ++cursor) {
+        operand = operand * 10 + (*cursor - '0');
+        if (operand > 0xFFFFFFFFUL) {
+            return 0;
+        }
+    }
+    update->operand = operand;
+    while (*cursor == ' ') {
+        ++cursor;
+    }
+    if (*cursor != '\0') {
+        return 0;
+    }
+    return update->clause == NULL || string_starts_with(update->clause, "id in ") ||
+           parse_filter(update->clause, &filter);
+}
+
+/**
+ * Given a model, a bitmap of its rows and the path of a file with one id
+ * per line, set the bit of every row whose id is in the file.
+ * 
+ * The ids of the file are turned into codes of the id dictionary and the
+ * rows are then compared by code in one pass, so the cost does not grow 
+ * with the number of ids times the number of rows.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the file could not be read.
+ */
+static char select_listed_ids(people_model *model, char *path, unsigned long *selected) {
+    char line[261];
+    FILE *id_file = fopen(path, "rb");
+    if (id_file == NULL) {
+        printf("Could not open the id file \"%s\".\n", path);
+        return 0;
+    }
+    model_require(model, COLUMN_ID, 0, model->count);
+    char *listed = calloc(model->ids.count + 1, sizeof(char));
+    if (listed == NULL) {
+        printf("Allocation fail [18]: could not select the rows.");
+        fclose(id_file);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), id_file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        int code = string_dict_lookup(&model->ids, line);
+        if (code >= 0) {
+            listed[code] = 1;
+        }
+    }
+    fclose(id_file);
+
+    for (unsigned int row = 0; row < model->count; ++row) {
+        if (listed[model->id_codes[row]]) {
+            selected[row / 64] |= 1UL << (row % 64);
+        }
+    }
+    free(listed);
+    return 1;
+}
+
+/**
+ * Given a model and a parsed update, select the rows the update changes:
+ * every row without a clause, the rows that pass the filter of the clause
+ * or the rows whose id is listed in the file of the clause.
+ * 
+ * args:
+ *  - model: the model. The columns of the clause are decoded if they are not yet.
+ *  - update: the update. `selected` is filled with a bitmap of 64 rows per
+ *            word that must be freed, and `selected_count` with the number
+ *            of selected rows.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the rows could not be selected.
+ */
+static char select_update_rows(people_model *model, column_update *update) {
+    unsigned int word_count = (model->count + 63) / 64;
+    row_filter filter;
+
+    if (update->clause != NULL && !string_starts_with(update->clause, "id in ")) {
+        parse_filter(update->clause, &filter);
+        update->selected = filter_model_bitmap(model, &filter);
+        if (update->selected == NULL) {
+            return 0;
+        }
+    } else {
+        update->selected = calloc(word_count + 1, sizeof(unsigned long));
+        if (update->selected == NULL) {
+            printf("Allocation fail [18]: could not select the rows.");
+            return 0;
+        }
+        if (update->clause != NULL) {
+            if (!select_listed_ids(model, update->clause + 6, update->selected)) {
+                return 0;
+            }
+        } else {
+            for (unsigned int word = 0; word < word_count; ++word) {
+                update->selected[word] = ~0UL;
+            }
+            if (model->count % 64 != 0) {
+                update->selected[word_count - 1] = (1UL << (model->count % 64)) - 1;
+            }
+        }
+    }
+
+    update->selected_count = 0;
+    for (unsigned int word = 0; word < word_count; ++word) {
+        for (unsigned long bits = update->selected[word]; bits != 0; bits &= bits - 1) {
+            ++update->selected_count;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Given an update and the value of a selected row, compute the new value.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the new value would be below 0 or 
+ *    above the largest unsigned int, in which case `updated` is the old value.
+ */
+static char get_updated_value(column_update *update, unsigned int value, unsigned int *updated) {
+    *updated = value;
+    if (update->operation == UPDATE_ADD) {
+        if (value > 0xFFFFFFFFu - update->operand) {
+            return 0;
+        }
+        *updated = value + update->operand;
+    } else if (update->operation == UPDATE_SUBTRACT) {
+        if (value < update->operand) {
+            return 0;
+        }
+        *updated = value - update->operand;
+    } else {
+        *updated = update->operand;
+    }
+    return 1;
+}
+
+/**
+ * Given the text of a CSV file, the offset where a line starts and the
+ * index of a column, find the next row as `table_scan_chunk` counts rows,
+ * skipping empty lines, and the bounds of its cell in the column. The cell
+ * ends before a comma, a carriage return or the end of the line. A row 
+ * without the column gets an empty cell at its end.
+ * 
+ * args:
+ *  - text: the text of the file.
+ *  - size: the number of chars of the text.
+ *  - offset: the offset of the line, moved to the end of the row.
+ *  - column_index: the index of the column, 0 for the first.
+ *  - cell_begin: filled with the offset of the cell.
+ *  - cell_end: filled with the offset after the cell.
+ * 
+ * return:
+ *  - returns 1 if a row was found and 0 at the end of the text.
+ */
+static char find_row_cell(
+    char *text,
+    unsigned long size,
+    unsigned long *offset,
+    unsigned int column_index,
+    unsigned long *cell_begin,
+    unsigned long *cell_end) {
+
+    while (*offset < size && text[*offset] == '\n') {
+        ++*offset;
+    }
+    if (*offset == size) {
+        return 0;
+    }
+    char *line = text + *offset;
+    char *line_end = memchr(line, '\n', size - *offset);
+    if (line_end == NULL) {
+        line_end = text + size;
+    }
+    char *cell = line;
+    for (unsigned int column = 0; column < column_index && cell != NULL; ++column) {
+        cell = memchr(cell, ',', line_end - cell);
+        cell = cell == NULL ? NULL : cell + 1;
+    }
+    if (cell == NULL) {
+        cell = line_end;
+    }
+    char *end = cell;
+    while (end < line_end && *end != ',' && *end != '\r') {
+        ++end;
+    }
+    *cell_begin = cell - text;
+    *cell_end = end - text;
+    *offset = line_end - text;
+    return 1;
+}
+
+/**
+ * Given the path of the CSV file a model was read from, and an update of
+ * the model whose rows are selected, write the new values of the selected
+ * rows to the file.
+ * 
+ * The file is mapped and read once to check every selected row: rows whose
+ * cell is empty are left empty and unselected, and the update fails if a
+ * cell no longer holds the value of the model or a new value is out of 
+ * range. If every new value has as many digits as the old one, only the
+ * cells are rewritten in the mapping, so only the pages that hold them are
+ * written back. Otherwise the file is streamed to a new file with a unique
+ * name next to it, which then replaces it. If the path is a symbolic link,
+ * the new file goes next to the file it points to and replaces that file.
+ * 
+ * args:
+ *  - path: the path of the file. Compressed files cannot be updated.
+ *  - model: the model of the file, before the update.
+ *  - update: the update, with its rows selected.
+ *  - cell_limit: the largest number of digits a new value may have, or 0
+ *                for no limit.
+ *  - in_place: filled with 1 if the file was rewritten in place and 0 if
+ *              it was replaced.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the file was left as it was.
+ */
+static char write_update(
+    char *path,
+    people_model *model,
+    column_update *update,
+    unsigned int cell_limit,
+    char *in_place) {
+
+    unsigned int *values = update->column == COLUMN_AGE ? model->ages : model->weights;
+    unsigned int column_index = update->column == COLUMN_AGE ? 2 : 3;
+    char *column_name = update->column == COLUMN_AGE ? "age" : "weight";
+    struct stat file_stat;
+    char *text = MAP_FAILED;
+    unsigned long size = 0;
+    FILE *output_file = NULL;
+    char *real_path = NULL;
+    char *temp_path = NULL;
+    char digits[10];
+    char return_value = 0;
+
+    FILE *probe = fopen(path, "rb");
+    if (probe == NULL) {
+        printf("Could not open \"%s\".\n", path);
+        return 0;
+    }
+    char compression = detect_compression(probe);
+    fclose(probe);
+    if (compression != COMPRESSION_NONE) {
+        printf("Compressed files cannot be updated.\n");
+        return 0;
+    }
+    int file = open(path, O_RDWR);
+    if (file < 0 || fstat(file, &file_stat) != 0 || file_stat.st_size == 0) {
+        printf("Could not open \"%s\" for writing.\n", path);
+        goto after_write;
+    }
+    size = file_stat.st_size;
+    text = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (text == MAP_FAILED) {
+        printf("Could not map \"%s\".\n", path);
+        goto after_write;
+    }
+    madvise(text, size, MADV_SEQUENTIAL);
+
+    *in_place = 1;
+    for (char pass = 0; pass < 2; ++pass) {
+        unsigned long offset = 0;
+        unsigned long cell_begin;
+        unsigned long cell_end;
+        unsigned long written = 0;
+        unsigned int updated;
+        long row = -1;
+
+        while (find_row_cell(text, size, &offset, column_index, &cell_begin, &cell_end)) {
+            if (row >= (long)model->count) {
+                row = -1;
+                break;
+            }
+            if (row < 0 || !(update->selected[row / 64] >> (row % 64) & 1)) {
+                ++row;
+                continue;
+            }
+            unsigned int cell_size = cell_end - cell_begin;
+            if (pass == 0 && cell_size == 0) {
+                update->selected[row / 64] &= ~(1UL << (row % 64));
+                --update->selected_count;
+            } else if (pass == 0 && parse_unsigned_int(text + cell_begin, cell_size) != values[row]) {
+                row = -1;
+                break;
+            } else if (pass == 0 && !get_updated_value(update, values[row], &updated)) {
+                printf("The update takes the %s of row %ld out of range.\n", column_name, row + 1);
+                goto after_write;
+            } else if (pass == 0) {
+                unsigned int length = format_unsigned_int(updated, digits);
+                if (cell_limit != 0 && length > cell_limit) {
+                    printf("The new %s of row %ld does not fit the table of the dataset.\n", column_name, row + 1);
+                    goto after_write;
+                }
+                *in_place = *in_place && length == cell_size;
+            } else {
+                get_updated_value(update, values[row], &updated);
+                unsigned int length = format_unsigned_int(updated, digits);
+                if (*in_place) {
+                    memcpy(text + cell_begin, digits, length);
+                } else {
+                    fwrite(text + written, 1, cell_begin - written, output_file);
+                    fwrite(digits, 1, length, output_file);
+                    written = cell_end;
+                }
+            }
+            ++row;
+        }
+
+        if (pass == 0 && row != model->count) {
+            printf("\"%s\" changed since it was read. Reload it before updating it.\n", path);
+            goto after_write;
+        }
+        if (pass == 0 && !*in_place) {
+            /* the new file replaces the file a link points to rather than
+               the link, and gets a name no other update is using */
+            real_path = realpath(path, NULL);
+            if (real_path == NULL) {
+                printf("Could not resolve \"%s\".\n", path);
+                goto after_write;
+            }
+            unsigned int temp_length = string_length(real_path) + 8;
+            temp_path = malloc(sizeof(char) * temp_length);
+            if (temp_path == NULL) {
+                printf("Allocation fail [18]: could not update the file.");
+                goto after_write;
+            }
+            snprintf(temp_path, temp_length, "%s.XXXXXX", real_path);
+            int temp_file = mkstemp(temp_path);
+            output_file = temp_file < 0 ? NULL : fdopen(temp_file, "wb");
+            if (output_file == NULL) {
+                printf("Could not create a new file next to \"%s\".\n", real_path);
+                if (temp_file >= 0) {
+                    close(temp_file);
+                    remove(temp_path);
+                }
+                goto after_write;
+            }
+        }
+        if (pass == 1 && !*in_place) {
+            fwrite(text + written, 1, size - written, output_file);
+        }
+    }
+
+    if (*in_place) {
+        return_value = msync(text, size, MS_SYNC) == 0;
+    } else {
+        return_value = fflush(output_file) == 0 && !ferror(output_file) &&
+                       fsync(fileno(output_file)) == 0 &&
+                       fchmod(fileno(output_file), file_stat.st_mode & 07777) == 0;
+        fclose(output_file);
+        output_file = NULL;
+        return_value = return_value && rename(temp_path, real_path) == 0;
+        if (!return_value) {
+            remove(temp_path);
+        }
+    }
+    if (!return_value) {
+        printf("Could not write \"%s\".\n", path);
+    }
+
+after_write:
+    if (output_file != NULL) {
+        fclose(output_file);
+        remove(temp_path);
+    }
+    free(real_path);
+    free(temp_path);
+    if (text != MAP_FAILED) {
+        munmap(text, size);
+    }
+    if (file >= 0) {
+        close(file);
+    }
+    return return_value;
+}
+
+/**
+ * Given a model and an update whose rows are selected and checked by 
+ * `write_update`, apply the update to the column of the model.
+ * 
+ * Words of the selection with all 64 rows selected are updated 4 values
+ * at a time with SSE2 when the compiler targets it, and the other rows one
+ * at a time. The minimum and maximum of every zone that holds an updated
+ * row are then found again, still without the empty cells.
+ */
+static void apply_column_update(people_model *model, column_update *update) {
+    unsigned int *values = update->column == COLUMN_AGE ? model->ages : model->weights;
+    zone_map *zones = update->column == COLUMN_AGE ? &model->age_zones : &model->weight_zones;
+    unsigned int word_count = (model->count + 63) / 64;
+    unsigned int operand = update->operand;
+
+    for (unsigned int word = 0; word < word_count; ++word) {
+        unsigned int *word_values = values + word * 64;
+        unsigned long bits = update->selected[word];
+#ifdef __SSE2__
+        if (bits == ~0UL) {
+            __m128i operands = _mm_set1_epi32((int)operand);
+            for (unsigned int index = 0; index < 64; index += 4) {
+                __m128i *target = (__m128i *)(word_values + index);
+                __m128i loaded = _mm_loadu_si128(target);
+                _mm_storeu_si128(target,
+                    update->operation == UPDATE_ADD ? _mm_add_epi32(loaded, operands) :
+                    update->operation == UPDATE_SUBTRACT ? _mm_sub_epi32(loaded, operands) : operands);
+            }
+            continue;
+        }
+#endif
+        for (unsigned int bit = 0; bits != 0; ++bit, bits >>= 1) {
+            if (bits & 1) {
+                word_values[bit] = update->operation == UPDATE_ADD ? word_values[bit] + operand :
+                                   update->operation == UPDATE_SUBTRACT ? word_values[bit] - operand : operand;
+            }
+        }
+    }
+
+    for (unsigned int zone = 0; zone < zones->zone_count && zone * ZONE_ROWS < model->count; ++zone) {
+        unsigned int begin = zone * ZONE_ROWS;
+        unsigned int end = begin + ZONE_ROWS < model->count ? begin + ZONE_ROWS : model->count;
+        unsigned long zone_bits = 0;
+        for (unsigned int word = begin / 64; word < (end + 63) / 64; ++word) {
+            zone_bits |= update->selected[word];
+        }
+        if (zone_bits == 0) {
+            continue;
+        }
+        zones->minimums[zone] = -1;
+        zones->maximums[zone] = 0;
+        for (unsigned int row = begin; row < end; ++row) {
+            if (zone_map_is_null(zones, row)) {
+                continue;
+            }
+            zones->minimums[zone] = values[row] < zones->minimums[zone] ? values[row] : zones->minimums[zone];
+            zones->maximums[zone] = values[row] > zones->maximums[zone] ? values[row] : zones->maximums[zone];
+        }
+    }
+}
+
+/**
+ * Given a table, the model over it and an applied update, write the new 
+ * values of the updated rows to their cells, so the modes that print the
+ * table print them. `write_update` checked that they fit the cells.
+ */
+static void update_table_cells(string_mat table, people_model *model, column_update *update) {
+    unsigned int *values = update->column == COLUMN_AGE ? model->ages : model->weights;
+    unsigned int column_index = update->column == COLUMN_AGE ? 2 : 3;
+    unsigned int cell_size = table.cell_size[0];
+    unsigned int word_count = (model->count + 63) / 64;
+
+    for (unsigned int word = 0; word < word_count; ++word) {
+        unsigned long bits = update->selected[word];
+        for (unsigned int bit = 0; bits != 0; ++bit, bits >>= 1) {
+            if (bits & 1) {
+                char *cell = table_data_cell(table, word * 64 + bit, column_index);
+                unsigned int length = format_unsigned_int(values[word * 64 + bit], cell);
+                memset(cell + length, '\0', cell_size - length);
+            }
+        }
+    }
+}
+
+/**
+ * Given an edge parser and a pending line, look up its ids and add it to the
+ * lines of the parser with its relations interned, or count it as skipped if
+ * the model does not hold one of its ids. The relations of skipped lines are
+ * not interned, so they do not count towards RELATION_MAX_TYPES.
+ */
+static void resolve_edge_line(edge_parser *parser, pending_edge *line) {
+    people_model *model = parser->model;
+    int codes[2];
+
+    for (unsigned int i = 0; i < 2; ++i) {
+        codes[i] = (int)model->ids.slots[string_dict_find_slot(
+            &model->ids, line->ids[i], line->id_lengths[i], line->hashes[i])] - 1;
+    }
+    if (codes[0] < 0 || codes[1] < 0) {
+        ++parser->skipped_count;
+        return;
+    }
+    int relation = string_dict_intern(&parser->graph->relation_types,
+                                      line->relations[0], line->relation_lengths[0]);
+    int back_relation = line->relations[1] == line->relations[0] ? relation :
+        string_dict_intern(&parser->graph->relation_types, line->relations[1], line->relation_lengths[1]);
+    if (relation < 0 || back_relation < 0) {
+        parser->corrupt = 1;
+        return;
+    }
+    if (parser->graph->relation_types.count > RELATION_MAX_TYPES) {
+        printf("The edge list has more than %u relation types.\n", RELATION_MAX_TYPES);
+        parser->corrupt = 1;
+        return;
+    }
+    if (parser->count == parser->capacity) {
+        edge_line *grown = realloc(parser->lines, sizeof(edge_line) * parser->capacity * 2);
+        if (grown == NULL) {
+            printf("Allocation fail [19]: could not read the relations.");
+            parser->corrupt = 1;
+            return;
+        }
+        parser->lines = grown;
+        parser->capacity *= 2;
+    }
+    edge_line *edge = &parser->lines[parser->count++];
+    edge->first = parser->code_rows[codes[0]];
+    edge->second = parser->code_rows[codes[1]];
+    edge->relation = relation;
+    edge->back_relation = back_relation;
+    ++parser->graph->offsets[edge->first + 1];
+    ++parser->graph->offsets[edge->second + 1];
+}
+
+/**
+ * Given an edge parser, look up the ids of all of its pending lines in order.
+ */
+static void flush_pending_edges(edge_parser *parser) {
+    while (parser->pending_count > 0 && !parser->corrupt) {
+        resolve_edge_line(parser, &parser->pending[parser->pending_first]);
+        parser->pending_first = (parser->pending_first + 1) % RELATION_PENDING_LINES;
+        --parser->pending_count;
+    }
+    parser->pending_count = 0;
+}
+
+/**
+ * A line parser of `split_block_lines` that adds the relation of one line
+ * of an edge list to an edge parser: "id,id,relation", then optionally the
+ * relation of the second person to the first, which is the same relation
+ * if it is missing, as `Person.new_relation` keeps them. Empty lines are
+ * skipped, and so is the first line if one of its first two fields is not
+ * an id of the model, as it is then a header. Other lines that name an id
+ * the model does not hold are counted and skipped, and a line without 3
+ * fields marks the parser as corrupt.
+ * 
+ * args:
+ *  - parser_pointer: a pointer to the edge_parser.
+ *  - line: the first char of the line.
+ *  - length: the length of the line without its new line.
+ */
+static void edge_parse_line(void *parser_pointer, char *line, unsigned long length) {
+    edge_parser *parser = parser_pointer;
+    people_model *model = parser->model;
+    char *fields[4];
+    unsigned int field_lengths[4];
+    unsigned int field_count = 0;
+    unsigned long field_start = 0;
+    pending_edge next;
+
+    if (length > 0 && line[length - 1] == '\r') {
+        --length;
+    }
+    if (length == 0 || parser->corrupt) {
+        return;
+    }
+    while (field_count < 4) {
+        char *comma = memchr(line + field_start, ',', length - field_start);
+        unsigned long field_end = comma ? (unsigned long)(comma - line) : length;
+        fields[field_count] = line + field_start;
+        field_lengths[field_count++] = field_end - field_start;
+        if (comma == NULL) {
+            break;
+        }
+        field_start = field_end + 1;
+    }
+    if (!parser->header_done) {
+        parser->header_done = 1;
+        if (field_count < 2 || string_dict_find(&model->ids, fields[0], field_lengths[0]) < 0 ||
+            string_dict_find(&model->ids, fields[1], field_lengths[1]) < 0) {
+            return;
+        }
+    }
+    if (field_count < 3 || field_lengths[2] == 0) {
+        parser->corrupt = 1;
+        return;
+    }
+
+    for (unsigned int i = 0; i < 2; ++i) {
+        next.ids[i] = fields[i];
+        next.id_lengths[i] = field_lengths[i];
+        next.hashes[i] = string_hash(fields[i], field_lengths[i]);
+    }
+    next.relations[0] = fields[2];
+    next.relation_lengths[0] = field_lengths[2];
+    next.relations[1] = field_count < 4 || field_lengths[3] == 0 ? fields[2] : fields[3];
+    next.relation_lengths[1] = field_count < 4 || field_lengths[3] == 0 ? field_lengths[2] : field_lengths[3];
+
+    /* the carried line is overwritten once the block is split, so it
+       cannot wait, but the lines of the block can until it is parsed */
+    if (line == parser->carry.text) {
+        resolve_edge_line(parser, &next);
+        return;
+    }
+    if (parser->pending_count == RELATION_PENDING_LINES) {
+        resolve_edge_line(parser, &parser->pending[parser->pending_first]);
+        parser->pending_first = (parser->pending_first + 1) % RELATION_PENDING_LINES;
+        --parser->pending_count;
+    }
+    for (unsigned int i = 0; i < 2; ++i) {
+        __builtin_prefetch(&model->ids.slots[next.hashes[i] & (model->ids.slot_count - 1)]);
+    }
+    parser->pending[(parser->pending_first + parser->pending_count++) % RELATION_PENDING_LINES] = next;
+
+    /* halfway through the ring the slots have arrived, so fetch the
+       strings and rows of the codes they hold */
+    if (parser->pending_count > RELATION_PENDING_LINES / 2) {
+        pending_edge *middle = &parser->pending[(parser->pending_first + parser->pending_count -
+                                                 RELATION_PENDING_LINES / 2 - 1) % RELATION_PENDING_LINES];
+        for (unsigned int i = 0; i < 2; ++i) {
+            unsigned int code = model->ids.slots[middle->hashes[i] & (model->ids.slot_count - 1)];
+            if (code != 0) {
+                __builtin_prefetch(&model->ids.offsets[code - 1]);
+                __builtin_prefetch(&parser->code_rows[code - 1]);
+            }
+        }
+    }
+}
+
+/**
+ * A consumer of `stream_file_blocks` that parses the complete lines of the
+ * block into an edge parser, see `edge_parse_line`.
+ */
+static void edge_parse_block(void *parser_pointer, char *block, unsigned long length) {
+    edge_parser *parser = parser_pointer;
+    if (!split_block_lines(&parser->carry, block, length, edge_parse_line, parser)) {
+        parser->corrupt = 1;
+    }
+    flush_pending_edges(parser);
+}
+
+/**
+ * Given a relation graph, free its adjacency and its relation types.
+ */
+static void deallocate_relation_graph(relation_graph *graph) {
+    free(graph->offsets);
+    free(graph->targets);
+    free(graph->types);
+    deallocate_string_dict(&graph->relation_types);
+}
+
+/**
+ * Given a model and the path of an edge list, a CSV file of "id,id,relation"
+ * lines, build the compressed sparse row adjacency of the relations between
+ * the rows of the model.
+ * 
+ * The file is streamed once (see `stream_file_blocks`), so it can be
+ * compressed: each line is turned into the rows of its ids and the codes
+ * of its relations, and the degree of both rows is counted. The ids of a
+ * line are looked up RELATION_PENDING_LINES lines after it is split, once
+ * their hash table slots are prefetched. The offsets of the rows are then
+ * the prefix sums of the degrees and every line is scattered to the
+ * relations of both of its rows, in the order of the file.
+ * 
+ * NOTE: to deallocate the graph, use the deallocate_relation_graph function.
+ * 
+ * args:
+ *  - model: the model. Its id column is decoded if it is not yet.
+ *  - path: the path of the edge list.
+ *  - graph: filled with the graph.
+ *  - skipped_count: filled with the number of lines naming an unknown id.
+ * 
+ * return:
+ *  - returns 1 on success and 0 if the file could not be read or is corrupt.
+ */
+static char build_relation_graph(people_model *model, char *path, relation_graph *graph, unsigned long *skipped_count) {
+    edge_parser parser;
+    char success = 0;
+    unsigned long *fill = NULL;
+    FILE *input_file = fopen(path, "rb");
+    if (input_file == NULL) {
+        printf("Could not open the edge list \"%s\".\n", path);
+        return 0;
+    }
+
+    model_require(model, COLUMN_ID, 0, model->count);
+    graph->vertex_count = model->count;
+    graph->edge_count = 0;
+    graph->offsets = calloc(model->count + 1, sizeof(unsigned long));
+    graph->targets = NULL;
+    graph->types = NULL;
+    string_dict_init(&graph->relation_types);
+    parser.model = model;
+    parser.graph = graph;
+    parser.code_rows = malloc(sizeof(unsigned int) * (model->ids.count + 1));
+    parser.capacity = 1024;
+    parser.count = 0;
+    parser.lines = malloc(sizeof(edge_line) * parser.capacity);
+    parser.skipped_count = 0;
+    parser.header_done = 0;
+    parser.corrupt = 0;
+    parser.pending_first = 0;
+    parser.pending_count = 0;
+    parser.carry.length = 0;
+    parser.carry.capacity = 256;
+    parser.carry.text = malloc(sizeof(char) * parser.carry.capacity);
+    if (graph->offsets == NULL || parser.code_rows == NULL || parser.lines == NULL) {
+        printf("Allocation fail [19]: could not read the relations.");
+        goto after_build;
+    }
+    for (unsigned int row = model->count; row > 0; --row) {
+        parser.code_rows[model->id_codes[row - 1]] = row - 1;
+    }
+
+    success = stream_file_blocks(input_file, edge_parse_block, &parser);
+    if (success && parser.carry.length > 0) {
+        edge_parse_line(&parser, parser.carry.text, parser.carry.length);
+    }
+    if (success && parser.corrupt) {
+        printf("The edge list is corrupt.\n");
+        success = 0;
+    }
+    if (!success) {
+        goto after_build;
+    }
+
+    for (unsigned int row = 0; row < model->count; ++row) {
+        graph->offsets[row + 1] += graph->offsets[row];
+    }
+    graph->edge_count = graph->offsets[model->count];
+    graph->targets = malloc(sizeof(unsigned int) * (graph->edge_count + 1));
+    graph->types = malloc(sizeof(unsigned short) * (graph->edge_count + 1));
+    fill = malloc(sizeof(unsigned long) * (model->count + 1));
+    if (graph->targets == NULL || graph->types == NULL || fill == NULL) {
+        printf("Allocation fail [19]: could not read the relations.");
+        success = 0;
+        goto after_build;
+    }
+    memcpy(fill, graph->offsets, sizeof(unsigned long) * model->count);
+    for (unsigned long i = 0; i < parser.count; ++i) {
+        edge_line *edge = &parser.lines[i];
+        graph->targets[fill[edge->first]] = edge->second;
+        graph->types[fill[edge->first]++] = edge->relation;
+        graph->targets[fill[edge->second]] = edge->first;
+        graph->types[fill[edge->second]++] = edge->back_relation;
+    }
+    *skipped_count = parser.skipped_count;
+
+after_build:
+    fclose(input_file);
+    free(parser.code_rows);
+    free(parser.lines);
+    free(parser.carry.text);
+    free(fill);
+    if (!success) {
+        deallocate_relation_graph(graph);
+    }
+    return success;
+}
+
+/**
+ * A task of `run_parallel_tasks` that expands one chunk of the frontier of
+ * a breadth first search: every relation of a frontier row that leads to a
+ * row not reached yet reaches it at the next depth. The row is claimed 
+ * with a compare and swap of its distance, so only one task adds it to the
+ * next frontier, and its parent is the smallest frontier row related to 
+ * it, so the search gives the same paths whatever the order of the tasks.
+ * If the reached rows cannot be kept the job is marked as failed and every
+ * task stops.
+ */
+static void expand_frontier_task(void *job_pointer, unsigned int chunk) {
+    frontier_job *job = job_pointer;
+    relation_graph *graph = job->graph;
+    unsigned int begin = chunk * RELATION_CHUNK_ROWS;
+    unsigned int end = begin + RELATION_CHUNK_ROWS < job->frontier_count ?
+                       begin + RELATION_CHUNK_ROWS : job->frontier_count;
+    unsigned int *found = NULL;
+    unsigned int found_count = 0;
+    unsigned int found_capacity = 0;
+
+    for (unsigned int i = begin; i < end && !__atomic_load_n(&job->failed, __ATOMIC_RELAXED); ++i) {
+        unsigned int row = job->frontier[i];
+        for (unsigned long edge = graph->offsets[row]; edge < graph->offsets[row + 1]; ++edge) {
+            unsigned int target = graph->targets[edge];
+            unsigned int unseen = RELATION_UNSEEN;
+            unsigned int distance = __atomic_load_n(&job->distances[target], __ATOMIC_RELAXED);
+            if (distance != RELATION_UNSEEN && distance != job->depth) {
+                continue;
+            }
+            if (__atomic_compare_exchange_n(&job->distances[target], &unseen, job->depth, 0,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                if (found_count == found_capacity) {
+                    unsigned int *grown = realloc(found, sizeof(unsigned int) * (found_capacity + 256) * 2);
+                    if (grown == NULL) {
+                        printf("Allocation fail [19]: could not search the relations.");
+                        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+                        goto after_expand;
+                    }
+                    found = grown;
+                    found_capacity = (found_capacity + 256) * 2;
+                }
+                found[found_count++] = target;
+            }
+            unsigned int parent = __atomic_load_n(&job->parents[target], __ATOMIC_RELAXED);
+            while (row < parent && !__atomic_compare_exchange_n(&job->parents[target], &parent, row, 0,
+                                                               __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            }
+        }
+    }
+
+after_expand:
+    job->found[chunk] = found;
+    job->found_counts[chunk] = found_count;
+}
+
+/**
+ * Given a relation graph and a row, search the graph breadth first from
+ * the row, one depth at a time. The frontier of each depth is split in 
+ * chunks of RELATION_CHUNK_ROWS rows expanded in parallel, see 
+ * `expand_frontier_task`, and the rows they reach are the next frontier,
+ * in the order of the rows.
+ * 
+ * NOTE: the returned array and the distances and parents must be freed.
+ * 
+ * args:
+ *  - graph: the graph.
+ *  - source: the row to search from.
+ *  - max_depth: the largest number of relations between the source and a
+ *               reached row.
+ *  - target: a row whose depth ends the search once it is reached, or -1.
+ *  - distances: filled with the number of relations between the source 
+ *               and each row, RELATION_UNSEEN for the rows not reached.
+ *  - parents: filled with the row each reached row was reached from.
+ *  - reached_count: filled with the number of reached rows.
+ * 
+ * return:
+ *  - the reached rows, the source first, by depth and then in order, or 
+ *    NULL if allocation fails.
+ */
+static unsigned int *search_relations(
+    relation_graph *graph,
+    unsigned int source,
+    unsigned int max_depth,
+    long target,
+    unsigned int **distances,
+    unsigned int **parents,
+    unsigned int *reached_count) {
+
+    frontier_job job;
+    unsigned int *reached = malloc(sizeof(unsigned int) * (graph->vertex_count + 1));
+    job.graph = graph;
+    job.distances = malloc(sizeof(unsigned int) * (graph->vertex_count + 1));
+    job.parents = malloc(sizeof(unsigned int) * (graph->vertex_count + 1));
+    *distances = job.distances;
+    *parents = job.parents;
+    *reached_count = 0;
+    if (reached == NULL || job.distances == NULL || job.parents == NULL) {
+        printf("Allocation fail [19]: could not search the relations.");
+        free(reached);
+        return NULL;
+    }
+    memset(job.distances, 0xFF, sizeof(unsigned int) * graph->vertex_count);
+    memset(job.parents, 0xFF, sizeof(unsigned int) * graph->vertex_count);
+    job.distances[source] = 0;
+    job.failed = 0;
+    reached[(*reached_count)++] = source;
+
+    unsigned int frontier_begin = 0;
+    for (job.depth = 1; job.depth <= max_depth && frontier_begin < *reached_count; ++job.depth) {
+        if (target >= 0 && job.distances[target] != RELATION_UNSEEN) {
+            break;
+        }
+        job.frontier = reached + frontier_begin;
+        job.frontier_count = *reached_count - frontier_begin;
+        unsigned int chunk_count = (job.frontier_count + RELATION_CHUNK_ROWS - 1) / RELATION_CHUNK_ROWS;
+        job.found = malloc(sizeof(unsigned int *) * chunk_count);
+        job.found_counts = malloc(sizeof(unsigned int) * chunk_count);
+        if (job.found == NULL || job.found_counts == NULL) {
+            printf("Allocation fail [19]: could not search the relations.");
+            job.failed = 1;
+        } else {
+            run_parallel_tasks(chunk_count, expand_frontier_task, &job);
+            frontier_begin = *reached_count;
+            for (unsigned int chunk = 0; chunk < chunk_count; ++chunk) {
+                if (!job.failed && job.found_counts[chunk] > 0) {
+                    memcpy(reached + *reached_count, job.found[chunk], sizeof(unsigned int) * job.found_counts[chunk]);
+                    *reached_count += job.found_counts[chunk];
+                }
+                free(job.found[chunk]);
+            }
+        }
+        free(job.found);
+        free(job.found_counts);
+        if (job.failed) {
+            free(reached);
+            *reached_count = 0;
+            return NULL;
+        }
+        qsort(reached + frontier_begin, *reached_count - frontier_begin, sizeof(unsigned int), compare_unsigned_ints);
+    }
+    return reached;
+}
+
+/**
+ * Given a relation graph and two related rows, find the relation of the
+ * first to the second: the first of its relations that leads to it.
+ */
+static char *get_relation_name(relation_graph *graph, unsigned int row, unsigned int target) {
+    for (unsigned long edge = graph->offsets[row]; edge < graph->offsets[row + 1]; ++edge) {
+        if (graph->targets[edge] == target) {
+            return string_dict_get(&graph->relation_types, graph->types[edge]);
+        }
+    }
+    return "";
+}
+
+/**
+ * Given a reached render and an index, append the id, the name and the 
+ * distance of the reached row at the index: "17 (Name17 Last17), 2 away".
+ */
+static void render_reached_person(void *render_pointer, unsigned int index, string_builder *buffer) {
+    reached_render *render = render_pointer;
+    people_model *model = render->model;
+    unsigned int row = render->rows[index];
+    char *id = string_dict_get(&model->ids, model->id_codes[row]);
+    char *name = string_dict_get(&model->names, model->name_codes[row]);
+    unsigned int id_length = string_length(id);
+    unsigned int name_length = string_length(name);
+
+    builder_reserve(buffer, id_length + name_length + 5);
+    memcpy(buffer->string + buffer->length, id, id_length);
+    memcpy(buffer->string + buffer->length + id_length, " (", 2);
+    buffer->length += id_length + 2;
+    memcpy(buffer->string + buffer->length, name, name_length);
+    memcpy(buffer->string + buffer->length + name_length, "), ", 3);
+    buffer->length += name_length + 3;
+    builder_append_unsigned_int(buffer, render->distances[row]);
+    builder_reserve(buffer, 6);
+    memcpy(buffer->string + buffer->length, " away\n", 6);
+    buffer->length += 6;
+}
+
+/**
+ * Given the text of a mode, find if it is one of the relation modes: 
+ * "load relations" and the path of an edge list, "relations" and an id,
+ * "within", a number of relations, "of" and an id, or "path", an id, "to"
+ * and an id.
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - first: filled with the path or the first id.
+ *  - second: filled with the second id of "path", a buffer of 261 chars.
+ *  - depth: filled with the number of relations of "within".
+ * 
+ * return:
+ *  - one of the RELATION_MODE_ modes, or RELATION_MODE_NONE.
+ */
+static char parse_relation_mode(char *user_input, char *first, char *second, unsigned int *depth) {
+    char *cursor;
+    if (string_starts_with(user_input, "load relations ")) {
+        snprintf(first, 261, "%s", user_input + 15);
+        return RELATION_MODE_LOAD;
+    }
+    if (string_starts_with(user_input, "relations ")) {
+        snprintf(first, 261, "%s", user_input + 10);
+        return RELATION_MODE_LIST;
+    }
+    if (string_starts_with(user_input, "within ")) {
+        unsigned long value = 0;
+        cursor = user_input + 7;
+        if (*cursor < '0' || *cursor > '9') {
+            return RELATION_MODE_NONE;
+        }
+        for (; *cursor >= '0' && *cursor <= '9'; ++cursor) {
+            value = value * 10 + (*cursor - '0');
+            if (value > 0xFFFFFFFEUL) {
+                return RELATION_MODE_NONE;
+            }
+        }
+        if (!string_starts_with(cursor, " of ")) {
+            return RELATION_MODE_NONE;
+        }
+        *depth = value;
+        snprintf(first, 261, "%s", cursor + 4);
+        return RELATION_MODE_WITHIN;
+    }
+    if (string_starts_with(user_input, "path ")) {
+        snprintf(first, 261, "%s", user_input + 5);
+        cursor = strstr(first, " to ");
+        if (cursor == NULL) {
+            return RELATION_MODE_NONE;
+        }
+        *cursor = '\0';
+        snprintf(second, 261, "%s", cursor + 4);
+        return RELATION_MODE_PATH;
+    }
+    return RELATION_MODE_NONE;
+}
+
+/**
+ * Given the text of a mode, find the columns of the model it reads.
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ * 
+ * return:
+ *  - the COLUMN_ flags of the needed columns, with COLUMN_TABLE for the 
+ *    modes that print the table and COLUMN_SKETCH for the sketch modes.
+ */
+static unsigned char get_mode_columns(char *user_input) {
+    unsigned char sort_column;
+    char descending;
+    char join_path[261];
+    int percentile;
+    char filtered_mode[261];
+    char *clause;
+    row_filter filter;
+    column_update update;
+    if (parse_update_mode(user_input, &update)) {
+        if (update.clause == NULL) {
+            return update.column;
+        }
+        if (string_starts_with(update.clause, "id in ")) {
+            return update.column | COLUMN_ID;
+        }
+        parse_filter(update.clause, &filter);
+        return update.column | filter.column_mask;
+    }
+    if (split_where_clause(user_input, filtered_mode, &clause)) {
+        unsigned char filter_columns = parse_filter(clause, &filter) ? filter.column_mask : 0;
+        if (string_compare(filtered_mode, "count")) {
+            return filter_columns;
+        }
+        if (string_compare(filtered_mode, "ids")) {
+            return filter_columns | COLUMN_ID;
+        }
+        return filter_columns | get_mode_columns(filtered_mode);
+    }
+    if (string_compare(user_input, "table")) {
+        return COLUMN_ALL | COLUMN_TABLE;
+    }
+    if (parse_sort_mode(user_input, &sort_column, &descending)) {
+        return sort_column | COLUMN_TABLE;
+    }
+    if (parse_join_mode(user_input, join_path) || parse_export_mode(user_input, join_path)) {
+        return COLUMN_ALL | COLUMN_TABLE;
+    }
+    if (parse_sketch_mode(user_input, &sort_column, &percentile)) {
+        return sort_column | COLUMN_SKETCH;
+    }
+    if (string_starts_with(user_input, "find name")) {
+        return COLUMN_ID | COLUMN_NAME;
+    }
+    if (string_compare(user_input, "average age") ||
+        string_compare(user_input, "min age") ||
+        string_compare(user_input, "max age")) {
+        return COLUMN_AGE;
+    }
+    if (string_compare(user_input, "average weight") ||
+        string_compare(user_input, "min weight") ||
+        string_compare(user_input, "max weight")) {
+        return COLUMN_WEIGHT;
+    }
+    if (string_compare(user_input, "group name")) {
+        return COLUMN_NAME | COLUMN_AGE | COLUMN_WEIGHT;
+    }
+    return COLUMN_ALL;
+}
+
+/**
+ * Given the text of a mode, find if it is one of the aggregate modes, 
+ * "average", "min" or "max" and "age" or "weight".
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - column: filled with COLUMN_AGE or COLUMN_WEIGHT.
+ *  - operation: filled with PEOPLE_AVERAGE, PEOPLE_MIN or PEOPLE_MAX.
+ * 
+ * return:
+ *  - returns 1 if the mode is an aggregate mode and 0 if not.
+ */
+static char parse_aggregate_mode(char *user_input, unsigned char *column, unsigned int *operation) {
+    char *operations[] = {"average ", "min ", "max "};
+    for (unsigned int i = 0; i < 3; ++i) {
+        if (string_starts_with(user_input, operations[i])) {
+            char *column_name = user_input + string_length(operations[i]);
+            *operation = i == 0 ? PEOPLE_AVERAGE : i == 1 ? PEOPLE_MIN : PEOPLE_MAX;
+            *column = string_compare(column_name, "age") ? COLUMN_AGE :
+                      string_compare(column_name, "weight") ? COLUMN_WEIGHT : 0;
+            return *column != 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Given a column, an aggregate and its value, print the value as the 
+ * aggregate modes do, with two decimals for averages.
+ */
+static void print_aggregate(unsigned char column, unsigned int operation, double value) {
+    char *column_name = column == COLUMN_AGE ? "age" : "weight";
+    if (operation == PEOPLE_AVERAGE) {
+        printf("The average %s is %0.2f\n", column_name, value);
+    } else {
+        printf("The %s %s is %d\n", operation == PEOPLE_MIN ? "minimum" : "maximum",
+               column_name, (unsigned int)value);
+    }
+}
+
+/**
+ * Given the text of a mode, write the key of its results in the result
+ * cache: the mode without leading, trailing or repeated spaces and, if 
+ * it has a valid "where" clause, with the clause rewritten in one form, so
+ * "count where age>40" and "count  where age > 40" share their results.
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - command: a buffer of RESULT_CACHE_KEY_SIZE characters, filled with the key.
+ */
+static void normalize_command(char *user_input, char *command) {
+    char filtered_mode[261];
+    char *clause;
+    row_filter filter;
+    char *operators[] = {"<", "<=", ">", ">=", "=", "!="};
+    unsigned int length = 0;
+
+    for (char *cursor = user_input; *cursor != '\0' && length < RESULT_CACHE_KEY_SIZE - 1; ++cursor) {
+        if (*cursor != ' ' || (length > 0 && command[length - 1] != ' ')) {
+            command[length++] = *cursor;
+        }
+    }
+    while (length > 0 && command[length - 1] == ' ') {
+        --length;
+    }
+    command[length] = '\0';
+
+    if (split_where_clause(command, filtered_mode, &clause) && parse_filter(clause, &filter)) {
+        length = snprintf(command, RESULT_CACHE_KEY_SIZE, "%s where", filtered_mode);
+        for (unsigned int i = 0; i < filter.term_count && length < RESULT_CACHE_KEY_SIZE; ++i) {
+            filter_term *term = &filter.terms[i];
+            length += snprintf(command + length, RESULT_CACHE_KEY_SIZE - length, "%s %s %s %u",
+                               i == 0 ? "" : term->or_before ? " or" : " and",
+                               term->column == COLUMN_AGE ? "age" : "weight",
+                               operators[term->operation], term->value);
+        }
+    }
+}
+
+/**
+ * Given a result cache and the key of a mode, find the results of the mode
+ * computed for the current generation of the dataset, and count the hit
+ * or the miss.
+ * 
+ * return:
+ *  - the cached results, or NULL if they are not cached.
+ */
+static cached_result *result_cache_find(result_cache *cache, char *command) {
+    cached_result *slot = &cache->slots[string_hash(command, string_length(command)) % RESULT_CACHE_SLOTS];
+    if (slot->command != NULL && slot->generation == cache->generation &&
+        string_compare(slot->command, command)) {
+        ++cache->hits;
+        return slot;
+    }
+    ++cache->misses;
+    return NULL;
+}
+
+/**
+ * Given a result cache, the key of a mode and its results, cache the 
+ * results for the current generation of the dataset. They replace the
+ * results of any other mode with the same slot.
+ * 
+ * args:
+ *  - cache: the cache.
+ *  - command: the key of the mode, see `normalize_command`.
+ *  - value: the value computed by the mode.
+ *  - count: the number of rows or the row found by the mode.
+ */
+static void result_cache_store(result_cache *cache, char *command, double value, long count) {
+    cached_result *slot = &cache->slots[string_hash(command, string_length(command)) % RESULT_CACHE_SLOTS];
+    unsigned int length = string_length(command);
+    char *copy = realloc(slot->command, length + 1);
+    if (copy == NULL) {
+        printf("Allocation fail [17]: the result is not cached.");
+        return;
+    }
+    memcpy(copy, command, length + 1);
+    slot->command = copy;
+    slot->generation = cache->generation;
+    slot->value = value;
+    slot->count = count;
+}
+
+/**
+ * Given a result cache, find the number of results cached for the current
+ * generation of the dataset.
+ */
+static unsigned int result_cache_count(result_cache *cache) {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < RESULT_CACHE_SLOTS; ++i) {
+        count += cache->slots[i].command != NULL && cache->slots[i].generation == cache->generation;
+    }
+    return count;
+}
+
+/**
+ * Given a result cache, free the keys it holds.
+ */
+static void deallocate_result_cache(result_cache *cache) {
+    for (unsigned int i = 0; i < RESULT_CACHE_SLOTS; ++i) {
+        free(cache->slots[i].command);
+        cache->slots[i].command = NULL;
+    }
+}
+
+/**
+ * Given a mode with a "where" clause, run the mode over the rows that pass
+ * the clause. The modes that can be filtered are "count", "ids", "model",
+ * "table", "sort by", "export arrow", "average", "min" and "max" of age 
+ * or weight.
+ * 
+ * args:
+ *  - user_input: the mode, without its clause.
+ *  - clause: the clause, without the "where".
+ *  - model: the model of the data file, with the columns the mode and the
+ *           clause need (see `get_mode_columns`), or lazy.
+ *  - table: the table of the data file. Only needed by "table" and "sort by".
+ *  - cache: the result cache of the dataset, or NULL. The count and the
+ *           aggregate modes are answered from it when they can be.
+ *  - command: the key of the mode in the cache, see `normalize_command`.
+ * 
+ * return:
+ *  - returns 1 if the mode was run and 0 if the mode or the clause is invalid.
+ */
+static char run_filtered_mode(
+    char *user_input,
+    char *clause,
+    people_model *model,
+    string_mat *table,
+    result_cache *cache,
+    char *command) {
+
+    row_filter filter;
+    unsigned int selected_count;
+    unsigned char sort_column;
+    char descending;
+    char export_path[261];
+    unsigned int batch_count;
+    unsigned char aggregate_column;
+    unsigned int operation;
+    cached_result *cached = NULL;
+    char return_value = 1;
+
+    if (!parse_filter(clause, &filter)) {
+        return 0;
+    }
+    char is_aggregate = parse_aggregate_mode(user_input, &aggregate_column, &operation);
+    if (cache != NULL && (is_aggregate || string_compare(user_input, "count"))) {
+        cached = result_cache_find(cache, command);
+    }
+    if (cached != NULL) {
+        printf("%u of %u people match \"%s\"\n", (unsigned int)cached->count, model->count, clause);
+        if (is_aggregate && cached->count > 0) {
+            print_aggregate(aggregate_column, operation, cached->value);
+        }
+        print_times(50, 2, "-");
+        return 1;
+    }
+    unsigned int *rows = filter_model_rows(model, &filter, &selected_count);
+    if (rows == NULL) {
+        return 0;
+    }
+    printf("%u of %u people match \"%s\"\n", selected_count, model->count, clause);
+
+    if (is_aggregate && selected_count > 0) {
+        unsigned int *values = aggregate_column == COLUMN_AGE ? model->ages : model->weights;
+        zone_map *zones = aggregate_column == COLUMN_AGE ? &model->age_zones : &model->weight_zones;
+        unsigned long value_sum = 0;
+        unsigned int smallest = -1;
+        unsigned int largest = 0;
+        double value;
+        model_require(model, aggregate_column, 0, model->count);
+        for (unsigned int i = 0; i < selected_count; ++i) {
+            unsigned int current = values[rows[i]];
+            value_sum += current;
+            if (zone_map_is_null(zones, rows[i])) {
+                continue;
+            }
+            smallest = current < smallest ? current : smallest;
+            largest = current > largest ? current : largest;
+        }
+        value = operation == PEOPLE_AVERAGE ? (double)value_sum / selected_count :
+                operation == PEOPLE_MIN ? smallest : largest;
+        /* the matching cells of the column may all be empty */
+        if (operation == PEOPLE_AVERAGE || smallest <= largest) {
+            if (cache != NULL) {
+                result_cache_store(cache, command, value, selected_count);
+            }
+            print_aggregate(aggregate_column, operation, value);
+        }
+        print_times(50, 2, "-");
+    } else if (is_aggregate || string_compare(user_input, "count")) {
+        if (cache != NULL) {
+            result_cache_store(cache, command, 0, selected_count);
+        }
+        print_times(50, 2, "-");
+    } else if (string_compare(user_input, "ids")) {
+        for (unsigned int i = 0; i < selected_count; ++i) {
+            print_found_id(model, rows[i]);
+        }
+        print_times(50, 2, "-");
+    } else if (string_compare(user_input, "model")) {
+        print_people(model, rows, selected_count);
+    } else if (string_compare(user_input, "table") && table != NULL) {
+        print_table_rows(*table, rows, selected_count);
+    } else if (parse_export_mode(user_input, export_path)) {
+        if (export_model_arrow(model, table, rows, selected_count, export_path, &batch_count)) {
+            printf("Exported %u people to %s in %u record batches\n", selected_count, export_path, batch_count);
+            print_times(50, 2, "-");
+        } else {
+            return_value = 0;
+        }
+    } else if (parse_sort_mode(user_input, &sort_column, &descending) && table != NULL) {
+        unsigned int *sorted_rows = sort_model_rows(model, sort_column, descending);
+        unsigned long *selected = calloc((model->count + 63) / 64 + 1, sizeof(unsigned long));
+        if (sorted_rows != NULL && selected != NULL) {
+            unsigned int kept = 0;
+            for (unsigned int i = 0; i < selected_count; ++i) {
+                selected[rows[i] / 64] |= 1UL << (rows[i] % 64);
+            }
+            for (unsigned int i = 0; i < model->count; ++i) {
+                if (selected[sorted_rows[i] / 64] >> (sorted_rows[i] % 64) & 1) {
+                    sorted_rows[kept++] = sorted_rows[i];
+                }
+            }
+            print_table_rows(*table, sorted_rows, kept);
+        } else {
+            return_value = 0;
+        }
+        free(sorted_rows);
+        free(selected);
+    } else {
+        return_value = 0;
+    }
+    free(rows);
+    return return_value;
+}
+
+/**
+ * Given the text of a mode, run it over the model.
+ * All modes aside from "exit" and the sketch modes are run here. 
+ * Modes with a "where" clause are run by `run_filtered_mode`.
+ * The min and max modes are answered from the zone maps of the model and
+ * the average mode sums its column straight into a double. They fail if
+ * the model holds no people.
+ * Modes that need a column the model does not hold fail.
+ * 
+ * args:
+ *  - user_input: the mode typed by the user.
+ *  - model: the model of the data file. Only the columns the mode needs
+ *           (see `get_mode_columns`) have to be built, or the model has to
+ *           be lazy, in which case they are built here.
+ *  - table: the table of the data file. Only needed by the "table", 
+ *           "sort by" and "join" modes, which fail without it. "export arrow"
+ *           uses it to find empty cells.
+ *  - names: the name index of the model, built when a mode first needs it.
+ *  - cache: the result cache of the dataset, or NULL. The aggregate modes,
+ *           the count mode and id lookups are answered from it when they 
+ *           can be, and their results are cached otherwise.
+ * 
+ * return:
+ *  - returns 1 if the mode was run and 0 if it is invalid or the id does not exist.
+ */
+static char run_mode(
+    char *user_input,
+    people_model *model,
+    string_mat *table,
+    name_index *names,
+    result_cache *cache) {
+
+    unsigned int smallest;
+    unsigned int largest;
+    unsigned char aggregate_column;
+    unsigned int operation;
+    double value;
+    cached_result *cached;
+    char command[RESULT_CACHE_KEY_SIZE];
+    char return_value = 1;
+    unsigned char sort_column;
+    char descending;
+    char join_path[261];
+    char filtered_mode[261];
+    char *clause;
+    unsigned int batch_count;
+
+    if (get_mode_columns(user_input) & COLUMN_ALL & ~model->column_mask) {
+        return_value = 0;
+        goto after_run_mode;
+    }
+    if (cache != NULL) {
+        normalize_command(user_input, command);
+    }
+    if (split_where_clause(user_input, filtered_mode, &clause)) {
+        return_value = run_filtered_mode(filtered_mode, clause, model, table, cache, command);
+        goto after_run_mode;
+    }
+    if (get_mode_columns(user_input) & COLUMN_TABLE) {
+        if (table == NULL) {
+            return_value = 0;
+            goto after_run_mode;
+        }
+    } else if (string_starts_with(user_input, "find name")) {
+        model_require(model, COLUMN_NAME, 0, model->count);
+    } else if (get_mode_columns(user_input) != COLUMN_ALL) {
+        model_require(model, get_mode_columns(user_input), 0, model->count);
+    } else if (string_compare(user_input, "model")) {
+        model_require(model, COLUMN_ALL, 0, model->count);
+    }
+
+    if (string_starts_with(user_input, "find name-prefix ")) {
+        name_index_build(names);
+        unsigned int match_count =
+            name_index_find_prefix(names, user_input + 17, print_found_id, model);
+        printf("%u names start with \"%s\"\n", match_count, user_input + 17);
+        print_times(50, 2, "-");
+        goto after_run_mode;
+    } else if (string_starts_with(user_input, "find name ")) {
+        name_index_build(names);
+        unsigned int match_count =
+            name_index_find_substring(names, user_input + 10, print_found_id, model);
+        printf("%u names contain \"%s\"\n", match_count, user_input + 10);
+        print_times(50, 2, "-");
+        goto after_run_mode;
+    } else if (string_compare(user_input, "table")) {
+        print_table(*table);
+        goto after_run_mode;
+    } else if (parse_sort_mode(user_input, &sort_column, &descending)) {
+        unsigned int *sorted_rows = sort_model_rows(model, sort_column, descending);
+        if (sorted_rows != NULL) {
+            print_table_rows(*table, sorted_rows, model->count);
+            free(sorted_rows);
+            goto after_run_mode;
+        }
+    } else if (parse_join_mode(user_input, join_path)) {
+        if (print_join(*table, join_path)) {
+            goto after_run_mode;
+        }
+    } else if (parse_export_mode(user_input, join_path)) {
+        if (export_model_arrow(model, table, NULL, 0, join_path, &batch_count)) {
+            printf("Exported %u people to %s in %u record batches\n", model->count, join_path, batch_count);
+            print_times(50, 2, "-");
+            goto after_run_mode;
+        }
+    } else if (string_compare(user_input, "model")) {
+        print_people(model, NULL, 0);
+        goto after_run_mode;
+    } else if (string_compare(user_input, "group name")) {
+        print_name_groups(model);
+        print_times(50, 2, "-");
+        goto after_run_mode;
+    } else if (parse_aggregate_mode(user_input, &aggregate_column, &operation)) {
+        cached = cache != NULL ? result_cache_find(cache, command) : NULL;
+        char computed = 1;
+        if (cached != NULL) {
+            value = cached->value;
+        } else if (operation == PEOPLE_AVERAGE) {
+            unsigned int *values = aggregate_column == COLUMN_AGE ? model->ages : model->weights;
+            unsigned long value_sum = 0;
+            for (unsigned int i = 0; i < model->count; ++i) {
+                value_sum += values[i];
+            }
+            computed = model->count > 0;
+            value = computed ? (double)value_sum / model->count : 0;
+        } else {
+            computed = model_zone_range(model, aggregate_column, &smallest, &largest);
+            value = operation == PEOPLE_MIN ? smallest : largest;
+        }
+        if (computed) {
+            if (cache != NULL && cached == NULL) {
+                result_cache_store(cache, command, value, model->count);
+            }
+            print_aggregate(aggregate_column, operation, value);
+            print_times(50, 2, "-");
+            goto after_run_mode;
+        }
+    } else {
+        long search_result;
+        snprintf(command, RESULT_CACHE_KEY_SIZE, "id %s", user_input);
+        cached = cache != NULL ? result_cache_find(cache, command) : NULL;
+        if (cached != NULL) {
+            search_result = cached->count;
+        } else {
+            search_result = model_find_id(model, user_input);
+            if (cache != NULL) {
+                result_cache_store(cache, command, 0, search_result);
+            }
+        }
+        if (search_result >= 0) {
+            print_person(model_get_person(model, search_result));
+            goto after_run_mode;
+        }
+    }
+    return_value = 0;
+
+after_run_mode:
+    return return_value;
+}
+
+/**
+ * Given a stirng, its length and a target_character and a replacement, search
+ * the length of the string for target_character and replace its first instance
+ * with replacement.
+ * 
+ * 
+ * args:
+ *  - target_string: the string to modify.
+ *  - target_char: the char to swap.
+ *  - replacement: the char to swap with.
+ *  - length: the length of the string.
+ * 
+ * return:
+ *  - the same pointer to target_string.
+ */
+static char *char_replace(char *target_string,
+    char target_char,
+    char replacement,
+    unsigned int length) {
+    for (unsigned int index = 0; index < length; ++index) {
+        if (target_string[index] == target_char) {
+            target_string[index] = replacement;
+        }
+    }
+    return target_string;
+}
+
+
+
+/**
+ * Given a path, find if it names a sharded dataset: a directory or a glob
+ * pattern that matches several files.
+ * 
+ * args:
+ *  - path: the path given to the program.
+ * 
+ * return:
+ *  - returns 1 if the path is a directory or contains glob characters and 0 if not.
+ */
+static char is_shard_path(char *path) {
+    struct stat path_stat;
+    if (stat(path, &path_stat) == 0) {
+        return S_ISDIR(path_stat.st_mode);
+    }
+    for (unsigned int index = 0; path[index] != '\0'; ++index) {
+        if (path[index] == '*' || path[index] == '?' || path[index] == '[') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Used by qsort to order shard paths by name, which keeps daily shards in 
+ * date order.
+ */
+static int compare_paths(const void *first, const void *second) {
+    return strcmp(*(char *const *)first, *(char *const *)second);
+}
+
+/**
+ * Given a directory or a glob pattern, allocate and return the sorted paths
+ * of the regular files it names. Hidden files of a directory are skipped.
+ * 
+ * args:
+ *  - path: the directory or the glob pattern.
+ *  - count: filled with the number of paths found.
+ * 
+ * return:
+ *  - an array of `count` allocated paths, or NULL if the path cannot be
+ *    listed or allocation fails.
+ */
+static char **list_shard_paths(char *path, unsigned int *count) {
+    char **return_paths = NULL;
+    unsigned int capacity = 0;
+    struct stat path_stat;
+    *count = 0;
+
+    if (stat(path, &path_stat) == 0 && S_ISDIR(path_stat.st_mode)) {
+        DIR *directory = opendir(path);
+        struct dirent *entry;
+        if (directory == NULL) {
+            return NULL;
+        }
+        while ((entry = readdir(directory)) != NULL) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            unsigned int length = string_length(path) + string_length(entry->d_name) + 1;
+            char *shard_path = allocate_string(length);
+            if (shard_path == NULL) {
+                closedir(directory);
+                goto after_allocation_fail;
+            }
+            snprintf(shard_path, length + 1, "%s/%s", path, entry->d_name);
+            if (stat(shard_path, &path_stat) != 0 || !S_ISREG(path_stat.st_mode)) {
+                free(shard_path);
+                continue;
+            }
+            if (*count == capacity) {
+                char **grown = realloc(return_paths, sizeof(char *) * (capacity ? capacity * 2 : 64));
+                if (grown == NULL) {
+                    free(shard_path);
+                    closedir(directory);
+                    goto after_allocation_fail;
+                }
+                return_paths = grown;
+                capacity = capacity ? capacity * 2 : 64;
+            }
+            return_paths[(*count)++] = shard_path;
+        }
+        closedir(directory);
+    } else {
+        glob_t matches;
+        if (glob(path, 0, NULL, &matches) != 0) {
+            return NULL;
+        }
+        return_paths = malloc(sizeof(char *) * (matches.gl_pathc + 1));
+        if (return_paths == NULL) {
+            globfree(&matches);
+            goto after_allocation_fail;
+        }
+        for (size_t i = 0; i < matches.gl_pathc; ++i) {
+            if (stat(matches.gl_pathv[i], &path_stat) != 0 || !S_ISREG(path_stat.st_mode)) {
+                continue;
+            }
+            unsigned int length = string_length(matches.gl_pathv[i]);
+            return_paths[*count] = allocate_string(length);
+            if (return_paths[*count] == NULL) {
+                globfree(&matches);
+                goto after_allocation_fail;
+            }
+            string_simple_copy(return_paths[(*count)++], matches.gl_pathv[i], length);
+        }
+        globfree(&matches);
+    }
+
+    if (*count > 1) {
+        qsort(return_paths, *count, sizeof(char *), compare_paths);
+    }
+    return return_paths;
+
+after_allocation_fail:
+    printf("Allocation fail [20]: could not list the shards.");
+    for (unsigned int i = 0; i < *count; ++i) {
+        free(return_paths[i]);
+    }
+    free(return_paths);
+    *count = 0;
+    return NULL;
+}
+
+/**
+ * Given a directory or a glob pattern, allocate and return the path of the 
+ * shard cache file of the dataset: `.shard_cache` inside the directory, 
+ * or inside the directory part of the glob pattern.
+ * 
+ * args:
+ *  - path: the directory or the glob pattern.
+ * 
+ * return:
+ *  - the allocated path of the cache file, or NULL if allocation fails.
+ */
+static char *get_shard_cache_path(char *path) {
+    struct stat path_stat;
+    unsigned int directory_length = string_length(path);
+
+    if (!(stat(path, &path_stat) == 0 && S_ISDIR(path_stat.st_mode))) {
+        while (directory_length > 0 && path[directory_length - 1] != '/') {
+            --directory_length;
+        }
+    }
+    char *return_path = allocate_string(directory_length + 13);
+    if (return_path == NULL) {
+        return NULL;
+    }
+    if (directory_length == 0) {
+        snprintf(return_path, directory_length + 14, ".shard_cache");
+    } else {
+        snprintf(return_path, directory_length + 14, "%.*s/.shard_cache",
+                 directory_length, path);
+    }
+    return return_path;
+}
+
+/**
+ * Given the path of a shard cache file and the shards of a dataset, mark every
+ * shard whose size and modification time match a cache entry as cached and
+ * take its aggregate from the entry.
+ * 
+ * Each line of the cache holds the size, the mtime as seconds.nanoseconds, 
+ * so a shard rewritten within a second is not taken for the cached one, the
+ * count, age sum, min and max, weight sum, min and max and then the path of
+ * one shard. Lines of older caches without the nanoseconds are ignored.
+ * 
+ * args:
+ *  - cache_path: the path of the cache file. A missing file is not an error.
+ *  - shards: the shards of the dataset.
+ *  - count: the number of shards.
+ */
+static void load_shard_cache(char *cache_path, shard *shards, unsigned int count) {
+    FILE *cache_file = fopen(cache_path, "r");
+    char line[4096];
+    if (!cache_file) {
+        return;
+    }
+    while (fgets(line, sizeof(line), cache_file)) {
+        unsigned long size;
+        long mtime;
+        long mtime_nanoseconds;
+        shard_aggregate aggregate;
+        int path_start = 0;
+        if (sscanf(line, "%lu %ld.%ld %lu %lu %u %u %lu %u %u %n",
+                   &size, &mtime, &mtime_nanoseconds, &aggregate.count,
+                   &aggregate.age_sum, &aggregate.age_min, &aggregate.age_max,
+                   &aggregate.weight_sum, &aggregate.weight_min, &aggregate.weight_max,
+                   &path_start) < 10 || path_start == 0) {
+            continue;
+        }
+        char_replace(line, '\n', '\0', sizeof(line));
+        for (unsigned int i = 0; i < count; ++i) {
+            if (shards[i].size == size && shards[i].mtime == mtime &&
+                shards[i].mtime_nanoseconds == mtime_nanoseconds &&
+                string_compare(shards[i].path, line + path_start)) {
+                shards[i].aggregate = aggregate;
+                shards[i].cached = 1;
+                break;
+            }
+        }
+    }
+    fclose(cache_file);
+}
+
+/**
+ * Given the path of a shard cache file and the shards of a dataset, write the
+ * aggregate of every shard that has one to the cache. 
+ * See `load_shard_cache` for the format.
+ * 
+ * args:
+ *  - cache_path: the path of the cache file.
+ *  - shards: the shards of the dataset.
+ *  - count: the number of shards.
+ */
+static void save_shard_cache(char *cache_path, shard *shards, unsigned int count) {
+    FILE *cache_file = fopen(cache_path, "w");
+    if (!cache_file) {
+        return;
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        if (!(shards[i].cached || shards[i].loaded)) {
+            continue;
+        }
+        fprintf(cache_file, "%lu %ld.%09ld %lu %lu %u %u %lu %u %u %s\n",
+                shards[i].size, shards[i].mtime, shards[i].mtime_nanoseconds, shards[i].aggregate.count,
+                shards[i].aggregate.age_sum, shards[i].aggregate.age_min,
+                shards[i].aggregate.age_max, shards[i].aggregate.weight_sum,
+                shards[i].aggregate.weight_min, shards[i].aggregate.weight_max,
+                shards[i].path);
+    }
+    fclose(cache_file);
+}
+
+/**
+ * Given a model, compute the partial aggregates of its ages and weights.
+ * Empty cells add 0 to the sums and are left out of the minimums and maximums.
+ * 
+ * args:
+ *  - model: the model to aggregate.
+ * 
+ * return:
+ *  - the aggregates. An empty model gives a count of 0.
+ */
+static shard_aggregate aggregate_model(people_model *model) {
+    shard_aggregate return_aggregate = {0, 0, -1, 0, 0, -1, 0};
+    for (unsigned int i = 0; i < model->count; ++i) {
+        unsigned int age = model->ages[i];
+        unsigned int weight = model->weights[i];
+        return_aggregate.age_sum += age;
+        return_aggregate.weight_sum += weight;
+        if (!zone_map_is_null(&model->age_zones, i)) {
+            if (age < return_aggregate.age_min) {
+                return_aggregate.age_min = age;
+            }
+            if (age > return_aggregate.age_max) {
+                return_aggregate.age_max = age;
+            }
+        }
+        if (!zone_map_is_null(&model->weight_zones, i)) {
+            if (weight < return_aggregate.weight_min) {
+                return_aggregate.weight_min = weight;
+            }
+            if (weight > return_aggregate.weight_max) {
+                return_aggregate.weight_max = weight;
+            }
+        }
+    }
+    return_aggregate.count = model->count;
+    return return_aggregate;
+}
+
+/**
+ * Given a target aggregate and a source aggregate, merge source into target.
+ * 
+ * args:
+ *  - target: the aggregate to merge into.
+ *  - source: the aggregate to merge.
+ */
+static void merge_shard_aggregate(shard_aggregate *target, shard_aggregate source) {
+    if (source.count == 0) {
+        return;
+    }
+    target->count += source.count;
+    target->age_sum += source.age_sum;
+    target->weight_sum += source.weight_sum;
+    if (source.age_min < target->age_min) {
+        target->age_min = source.age_min;
+    }
+    if (source.age_max > target->age_max) {
+        target->age_max = source.age_max;
+    }
+    if (source.weight_min < target->weight_min) {
+        target->weight_min = source.weight_min;
+    }
+    if (source.weight_max > target->weight_max) {
+        target->weight_max = source.weight_max;
+    }
+}
+
+/**
+ * A task of `run_parallel_tasks` that loads the rows of one shard, builds its
+ * model and computes its aggregate. Shards that are already loaded are skipped,
+ * and so are cached shards unless the rows are needed.
+ * 
+ * args:
+ *  - set_pointer: a pointer to the shard_set.
+ *  - index: the index of the shard in the set.
+ */
+static void load_shard_task(void *set_pointer, unsigned int index) {
+    shard_set *set = set_pointer;
+    shard *target = &set->shards[index];
+    table_scan scan;
+
+    if (target->loaded || target->failed || (target->cached && !set->need_rows)) {
+        return;
+    }
+
+    FILE *input_file = fopen(target->path, "rb");
+    if (!input_file) {
+        target->failed = 1;
+        return;
+    }
+    char *raw_string = get_string_from_file_stream(input_file, &scan);
+    fclose(input_file);
+    if (raw_string == NULL) {
+        target->failed = 1;
+        return;
+    }
+    target->table = build_table_from_scan(raw_string, scan);
+    free(raw_string);
+
+    if (!validate_table(target->table, 4)) {
+        deallocate_string_mat(target->table);
+        target->failed = 1;
+        return;
+    }
+    target->model = build_model(target->table, target->table.row_count[0] - 1);
+    target->aggregate = aggregate_model(&target->model);
+    target->loaded = 1;
+}
+
+/**
+ * A task of `run_parallel_tasks` that searches the id column of one loaded
+ * shard for the id of the set.
+ * 
+ * args:
+ *  - set_pointer: a pointer to the shard_set.
+ *  - index: the index of the shard in the set.
+ */
+static void search_shard_task(void *set_pointer, unsigned int index) {
+    shard_set *set = set_pointer;
+    set->search_results[index] = -1;
+    if (set->shards[index].loaded) {
+        set->search_results[index] =
+            model_find_id(&set->shards[index].model, set->search_id);
+    }
+}
+
+/**
+ * Given a shard set, load the shards that are still needed in parallel and 
+ * report the shards that could not be loaded.
+ * 
+ * args:
+ *  - set: the shard set. need_rows decides if cached shards are loaded too.
+ * 
+ * return:
+ *  - the number of shards that failed to load.
+ */
+static unsigned int load_shards(shard_set *set) {
+    unsigned int failed_count = 0;
+    run_parallel_tasks(set->count, load_shard_task, set);
+    for (unsigned int i = 0; i < set->count; ++i) {
+        if (set->shards[i].failed == 1) {
+            printf("The shard \"%s\" is corrupt or unreadable: skipping it.\n",
+                   set->shards[i].path);
+            set->shards[i].failed = 2;
+            ++failed_count;
+        }
+    }
+    return failed_count;
+}
+
+/**
+ * Given a dataset whose table is set, make the lazy model and the name 
+ * index over the table.
+ */
+static void dataset_init_table(people_dataset *dataset) {
+    dataset->has_table = 1;
+    model_init_lazy(&dataset->model, dataset->table, dataset->table.row_count[0] - 1);
+    dataset->names.model = &dataset->model;
+    dataset->names.count = dataset->model.count;
+}
+
+/**
+ * Given a string of comma separated values and the first reading pass over
+ * it, build the table and the lazy model of a new dataset.
+ * 
+ * args:
+ *  - raw_string: the string. It is kept as the text of the dataset if 
+ *                keep_text is 1 and freed otherwise.
+ *  - scan: the finished table scan of raw_string.
+ *  - keep_text: 1 to keep raw_string for `people_text`.
+ * 
+ * return:
+ *  - the dataset, or NULL if the table is corrupt.
+ */
+static people_dataset *dataset_from_string(char *raw_string, table_scan scan, char keep_text) {
+    people_dataset *dataset = calloc(1, sizeof(people_dataset));
+    if (dataset == NULL) {
+        printf("Allocation fail [9]: returning NULL.");
+        free(raw_string);
+        return NULL;
+    }
+    dataset->table = build_table_from_scan(raw_string, scan);
+    if (keep_text) {
+        dataset->text = raw_string;
+    } else {
+        free(raw_string);
+    }
+
+    if (!validate_table(dataset->table, 4)) {
+        printf("The CSV file is corrupt.\n");
+        deallocate_string_mat(dataset->table);
+        free(dataset->text);
+        free(dataset);
+        return NULL;
+    }
+    dataset_init_table(dataset);
+    return dataset;
+}
+
+/**
+ * Given a directory or a glob pattern, open it as a sharded dataset.
+ * 
+ * The shards are loaded in parallel, one task per shard, and are never 
+ * concatenated. Aggregates of unchanged shards are taken from the shard
+ * cache, so those shards are only read when a mode needs their rows.
+ * 
+ * args:
+ *  - path: the directory or the glob pattern.
+ * 
+ * return:
+ *  - the dataset, or NULL if no shard was found.
+ */
+static people_dataset *open_shard_dataset(char *path) {
+    people_dataset *dataset;
+    shard_set set;
+    struct stat shard_stat;
+    char **paths = list_shard_paths(path, &set.count);
+    if (paths == NULL || set.count == 0) {
+        printf("No shard files found for \"%s\".\n", path);
+        free(paths);
+        return NULL;
+    }
+
+    dataset = calloc(1, sizeof(people_dataset));
+    set.shards = calloc(set.count, sizeof(shard));
+    if (dataset == NULL || set.shards == NULL) {
+        printf("Allocation fail [20]: could not open the shards.");
+        for (unsigned int i = 0; i < set.count; ++i) {
+            free(paths[i]);
+        }
+        free(paths);
+        free(dataset);
+        free(set.shards);
+        return NULL;
+    }
+    set.need_rows = 0;
+    for (unsigned int i = 0; i < set.count; ++i) {
+        set.shards[i].path = paths[i];
+        if (stat(paths[i], &shard_stat) == 0) {
+            set.shards[i].size = shard_stat.st_size;
+            set.shards[i].mtime = shard_stat.st_mtim.tv_sec;
+            set.shards[i].mtime_nanoseconds = shard_stat.st_mtim.tv_nsec;
+        }
+    }
+    free(paths);
+
+    char *cache_path = get_shard_cache_path(path);
+    if (cache_path != NULL) {
+        load_shard_cache(cache_path, set.shards, set.count);
+    }
+    load_shards(&set);
+    if (cache_path != NULL) {
+        save_shard_cache(cache_path, set.shards, set.count);
+    }
+    free(cache_path);
+
+    dataset->is_sharded = 1;
+    dataset->set = set;
+    dataset->total = (shard_aggregate){0, 0, -1, 0, 0, -1, 0};
+    for (unsigned int i = 0; i < set.count; ++i) {
+        if (set.shards[i].cached || set.shards[i].loaded) {
+            merge_shard_aggregate(&dataset->total, set.shards[i].aggregate);
+        }
+        dataset->cached_count += set.shards[i].cached && !set.shards[i].loaded;
+    }
+    return dataset;
+}
+
+/**
+ * Given a sharded dataset, load the rows of every shard, if not loaded yet,
+ * and find where the rows of each shard start in the dataset.
+ * 
+ * args:
+ *  - dataset: the sharded dataset.
+ */
+static void dataset_load_shard_rows(people_dataset *dataset) {
+    if (dataset->shard_offsets != NULL) {
+        return;
+    }
+    dataset->set.need_rows = 1;
+    load_shards(&dataset->set);
+    dataset->shard_offsets = malloc(sizeof(unsigned long) * (dataset->set.count + 1));
+    dataset->shard_offsets[0] = 0;
+    for (unsigned int i = 0; i < dataset->set.count; ++i) {
+        shard *target = &dataset->set.shards[i];
+        dataset->shard_offsets[i + 1] =
+            dataset->shard_offsets[i] + (target->loaded ? target->model.count : 0);
+    }
+}
+
+/**
+ * Given a dataset and a row of it, find the model that holds the row.
+ * 
+ * args:
+ *  - dataset: the dataset.
+ *  - row: the row of the dataset. Filled with the row inside the model.
+ * 
+ * return:
+ *  - the model, or NULL if the row does not exist.
+ */
+static people_model *dataset_locate_row(people_dataset *dataset, unsigned long *row) {
+    if (!dataset->is_sharded) {
+        return *row < dataset->model.count ? &dataset->model : NULL;
+    }
+    dataset_load_shard_rows(dataset);
+    for (unsigned int i = 0; i < dataset->set.count; ++i) {
+        if (*row < dataset->shard_offsets[i + 1]) {
+            *row -= dataset->shard_offsets[i];
+            return &dataset->set.shards[i].model;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Given a sharded dataset and an id, search every shard in parallel.
+ * 
+ * return:
+ *  - the row of the first shard, in path order, with the id, or -1.
+ */
+static long dataset_find_shard_id(people_dataset *dataset, char *id) {
+    long return_row = -1;
+    dataset_load_shard_rows(dataset);
+    dataset->set.search_id = id;
+    dataset->set.search_results = malloc(sizeof(int) * dataset->set.count);
+    run_parallel_tasks(dataset->set.count, search_shard_task, &dataset->set);
+    for (unsigned int i = 0; i < dataset->set.count; ++i) {
+        if (dataset->set.search_results[i] >= 0) {
+            return_row = dataset->shard_offsets[i] + dataset->set.search_results[i];
+            break;
+        }
+    }
+    free(dataset->set.search_results);
+    return return_row;
+}
+
+/**
+ * A task of `dataset_sketches`: sketch the rows of one shard.
+ */
+static void sketch_shard_task(void *job_pointer, unsigned int index) {
+    shard_sketch_job *job = job_pointer;
+    shard *target = &job->set->shards[index];
+    if (!target->loaded || !sketch_model(&target->model, job->column_mask, &job->shard_sketches[index])) {
+        sketches_init(&job->shard_sketches[index], job->column_mask);
+    }
+}
+
+/**
+ * Given a dataset and a column mask, find sketches of the columns of the
+ * mask over all of its rows. They are built from the model, or from every
+ * shard in parallel and then merged, and kept for the next sketch modes.
+ * 
+ * return:
+ *  - the sketches, or NULL if the dataset does not hold the columns.
+ */
+static people_sketches *dataset_sketches(people_dataset *dataset, unsigned char column_mask) {
+    people_sketches sketches;
+    column_mask &= COLUMN_ALL;
+    if (dataset->sketches != NULL && (dataset->sketches->column_mask & column_mask) == column_mask) {
+        return dataset->sketches;
+    }
+
+    if (dataset->is_sharded) {
+        shard_sketch_job job;
+        dataset_load_shard_rows(dataset);
+        job.set = &dataset->set;
+        job.column_mask = column_mask;
+        job.shard_sketches = malloc(sizeof(people_sketches) * dataset->set.count);
+        if (job.shard_sketches == NULL) {
+            printf("Allocation fail [12]: could not sketch the shards.");
+            return NULL;
+        }
+        run_parallel_tasks(dataset->set.count, sketch_shard_task, &job);
+        sketches_init(&sketches, column_mask);
+        for (unsigned int i = 0; i < dataset->set.count; ++i) {
+            sketches_merge(&sketches, &job.shard_sketches[i]);
+            deallocate_sketches(&job.shard_sketches[i]);
+        }
+        free(job.shard_sketches);
+    } else if (!sketch_model(&dataset->model, column_mask, &sketches)) {
+        return NULL;
+    }
+
+    if (dataset->sketches == NULL) {
+        dataset->sketches = malloc(sizeof(people_sketches));
+    } else {
+        deallocate_sketches(dataset->sketches);
+    }
+    *dataset->sketches = sketches;
+    return dataset->sketches;
+}
+
+/**
+ * Given a sharded dataset, print the groups of `print_name_groups` over all
+ * of its shards. The names of each shard are interned in a merged 
+ * dictionary, in the order of the shards, so the names keep the order they
+ * first appear in, and the counts and sums of each shard are added to the
+ * groups of their merged codes.
+ * 
+ * args:
+ *  - dataset: the sharded dataset. Its rows are loaded if they are not yet.
+ */
+static void print_shard_name_groups(people_dataset *dataset) {
+    string_dict names;
+    unsigned int group_capacity = 0;
+    unsigned int *counts = NULL;
+    unsigned long *age_sums = NULL;
+    unsigned long *weight_sums = NULL;
+    unsigned int *merged_codes = NULL;
+
+    dataset_load_shard_rows(dataset);
+    string_dict_init(&names);
+    for (unsigned int i = 0; i < dataset->set.count; ++i) {
+        if (dataset->set.shards[i].loaded) {
+            group_capacity += dataset->set.shards[i].model.names.count;
+        }
+    }
+    counts = calloc(group_capacity + 1, sizeof(unsigned int));
+    age_sums = calloc(group_capacity + 1, sizeof(unsigned long));
+    weight_sums = calloc(group_capacity + 1, sizeof(unsigned long));
+    if (counts == NULL || age_sums == NULL || weight_sums == NULL) {
+        printf("Allocation fail [8]: could not group the names.");
+        goto after_groups;
+    }
+
+    for (unsigned int i = 0; i < dataset->set.count; ++i) {
+        people_model *model = &dataset->set.shards[i].model;
+        if (!dataset->set.shards[i].loaded) {
+            continue;
+        }
+        merged_codes = malloc(sizeof(unsigned int) * (model->names.count + 1));
+        if (merged_codes == NULL) {
+            printf("Allocation fail [8]: could not group the names.");
+            goto after_groups;
+        }
+        for (unsigned int code = 0; code < model->names.count; ++code) {
+            char *name = string_dict_get(&model->names, code);
+            int merged_code = string_dict_intern(&names, name, string_length(name));
+            if (merged_code < 0) {
+                goto after_groups;
+            }
+            merged_codes[code] = merged_code;
+        }
+        for (unsigned int row = 0; row < model->count; ++row) {
+            unsigned int code = merged_codes[model->name_codes[row]];
+            ++counts[code];
+            age_sums[code] += model->ages[row];
+            weight_sums[code] += model->weights[row];
+        }
+        free(merged_codes);
+        merged_codes = NULL;
+    }
+    print_group_lines(&names, counts, age_sums, weight_sums);
+
+after_groups:
+    deallocate_string_dict(&names);
+    free(counts);
+    free(age_sums);
+    free(weight_sums);
+    free(merged_codes);
+}
+
+/**
+ * Given a sharded dataset and a mode with a "where" clause, run the mode
+ * over the rows of every shard that pass the clause, as `run_filtered_mode`
+ * does for a single file. The matching rows of each shard are counted and
+ * summed, then merged like the aggregates of the shards. "count", "ids",
+ * "model" and the average, min and max modes can be filtered, but not the
+ * modes that need the table of a single file.
+ * 
+ * args:
+ *  - dataset: the sharded dataset. Its rows are loaded if they are not yet.
+ *  - user_input: the mode, without its clause.
+ *  - clause: the clause, without the "where".
+ *  - command: the key of the mode in the cache, see `normalize_command`.
+ * 
+ * return:
+ *  - returns 1 if the mode was run and 0 if the mode or the clause is invalid.
+ */
+static char run_shard_filtered_mode(people_dataset *dataset, char *user_input, char *clause, char *command) {
+    row_filter filter;
+    unsigned char aggregate_column;
+    unsigned int operation;
+    shard_aggregate matched = {0, 0, -1, 0, 0, -1, 0};
+    cached_result *cached = NULL;
+    unsigned int **shard_rows = NULL;
+    unsigned int *shard_counts = NULL;
+    char return_value = 0;
+
+    if (!parse_filter(clause, &filter)) {
+        return 0;
+    }
+    char is_aggregate = parse_aggregate_mode(user_input, &aggregate_column, &operation);
+    char lists_rows = string_compare(user_input, "ids") || string_compare(user_input, "model");
+    if (!is_aggregate && !lists_rows && !string_compare(user_input, "count")) {
+        printf("Only \"count\", \"ids\", \"model\", averages, minimums and maximums can be "
+               "filtered on shards.\n");
+        return 0;
+    }
+    if (!lists_rows) {
+        cached = result_cache_find(&dataset->cache, command);
+    }
+    if (cached != NULL) {
+        printf("%u of %lu people match \"%s\"\n", (unsigned int)cached->count, dataset->total.count, clause);
+        if (is_aggregate && cached->count > 0) {
+            print_aggregate(aggregate_column, operation, cached->value);
+        }
+        print_times(50, 2, "-");
+        return 1;
+    }
+
+    dataset_load_shard_rows(dataset);
+    shard_rows = calloc(dataset->set.count + 1, sizeof(unsigned int *));
+    shard_counts = calloc(dataset->set.count + 1, sizeof(unsigned int));
+    if (shard_rows == NULL || shard_counts == NULL) {
+        printf("Allocation fail [13]: could not filter the shards.");
+        goto after_filter;
+    }
+    for (unsigned int i = 0; i < dataset->set.count; ++i) {
+        people_model *model = &dataset->set.shards[i].model;
+        shard_aggregate part = {0, 0, -1, 0, 0, -1, 0};
+        if (!dataset->set.shards[i].loaded) {
+            continue;
+        }
+        shard_rows[i] = filter_model_rows(model, &filter, &shard_counts[i]);
+        if (shard_rows[i] == NULL) {
+            goto after_filter;
+        }
+        for (unsigned int j = 0; j < shard_counts[i]; ++j) {
+            unsigned int row = shard_rows[i][j];
+            unsigned int age = model->ages[row];
+            unsigned int weight = model->weights[row];
+            part.age_sum += age;
+            if (!zone_map_is_null(&model->age_zones, row)) {
+                part.age_min = age < part.age_min ? age : part.age_min;
+                part.age_max = age > part.age_max ? age : part.age_max;
+            }
+            part.weight_sum += weight;
+            if (!zone_map_is_null(&model->weight_zones, row)) {
+                part.weight_min = weight < part.weight_min ? weight : part.weight_min;
+                part.weight_max = weight > part.weight_max ? weight : part.weight_max;
+            }
+        }
+        part.count = shard_counts[i];
+        merge_shard_aggregate(&matched, part);
+    }
+    printf("%lu of %lu people match \"%s\"\n", matched.count, dataset->total.count, clause);
+
+    if (lists_rows) {
+        for (unsigned int i = 0; i < dataset->set.count; ++i) {
+            people_model *model = &dataset->set.shards[i].model;
+            if (shard_counts[i] == 0) {
+                continue;
+            }
+            if (string_compare(user_input, "model")) {
+                print_people(model, shard_rows[i], shard_counts[i]);
+            } else {
+                for (unsigned int j = 0; j < shard_counts[i]; ++j) {
+                    print_found_id(model, shard_rows[i][j]);
+                }
+            }
+        }
+        if (string_compare(user_input, "ids")) {
+            print_times(50, 2, "-");
+        }
+    } else {
+        double value = 0;
+        unsigned int smallest = aggregate_column == COLUMN_AGE ? matched.age_min : matched.weight_min;
+        unsigned int largest = aggregate_column == COLUMN_AGE ? matched.age_max : matched.weight_max;
+        char computed = 1;
+        if (is_aggregate && matched.count > 0) {
+            if (operation == PEOPLE_AVERAGE) {
+                value = (double)(aggregate_column == COLUMN_AGE ? matched.age_sum : matched.weight_sum) /
+                        matched.count;
+            } else {
+                /* the matching cells of the column may all be empty */
+                computed = smallest <= largest;
+                value = operation == PEOPLE_MIN ? smallest : largest;
+            }
+            if (computed) {
+                print_aggregate(aggregate_column, operation, value);
+            }
+        }
+        if (computed) {
+            result_cache_store(&dataset->cache, command, value, matched.count);
+        }
+        print_times(50, 2, "-");
+    }
+    return_value = 1;
+
+after_filter:
+    if (shard_rows != NULL) {
+        for (unsigned int i = 0; i < dataset->set.count; ++i) {
+            free(shard_rows[i]);
+        }
+    }
+    free(shard_rows);
+    free(shard_counts);
+    return return_value;
+}
+
+/**
+ * Given a sharded dataset and the text of a mode, run the mode over the
+ * shards. The min, max and average modes use the merged aggregates, see
+ * `people_aggregate`, and fail if the shards hold no people. "group name"
+ * merges the groups of the shards, see `print_shard_name_groups`, and 
+ * modes with a "where" clause are run by `run_shard_filtered_mode`.
+ * 
+ * args:
+ *  - dataset: the sharded dataset.
+ *  - user_input: the mode typed by the user.
+ * 
+ * Rows found by id lookups are kept in the result cache of the dataset,
+ * since finding them can load every shard.
+ * 
+ * return:
+ *  - returns 1 if the mode was run and 0 if it is invalid or the id does not exist.
+ */
+static char run_shard_mode(people_dataset *dataset, char *user_input) {
+    unsigned char aggregate_column;
+    unsigned int operation;
+    double value;
+    char command[RESULT_CACHE_KEY_SIZE];
+    char filtered_mode[261];
+    char *clause;
+
+    if (split_where_clause(user_input, filtered_mode, &clause)) {
+        normalize_command(user_input, command);
+        return run_shard_filtered_mode(dataset, filtered_mode, clause, command);
+    }
+    if (parse_aggregate_mode(user_input, &aggregate_column, &operation)) {
+        if (!people_aggregate(dataset, aggregate_column, operation, &value)) {
+            return 0;
+        }
+        print_aggregate(aggregate_column, operation, value);
+        print_times(50, 2, "-");
+    } else if (string_compare(user_input, "group name")) {
+        print_shard_name_groups(dataset);
+        print_times(50, 2, "-");
+    } else if (string_compare(user_input, "model")) {
+        dataset_load_shard_rows(dataset);
+        for (unsigned int i = 0; i < dataset->set.count; ++i) {
+            shard *target = &dataset->set.shards[i];
+            if (target->loaded) {
+                print_people(&target->model, NULL, 0);
+            }
+        }
+    } else {
+        char command[RESULT_CACHE_KEY_SIZE];
+        snprintf(command, RESULT_CACHE_KEY_SIZE, "id %s", user_input);
+        cached_result *cached = result_cache_find(&dataset->cache, command);
+        long search_result = cached != NULL ? cached->count : dataset_find_shard_id(dataset, user_input);
+        if (cached == NULL) {
+            result_cache_store(&dataset->cache, command, 0, search_result);
+        }
+        if (search_result < 0) {
+            return 0;
+        }
+        unsigned long row = search_result;
+        people_model *model = dataset_locate_row(dataset, &row);
+        print_person(model_get_person(model, row));
+    }
+    return 1;
+}
+
+/**
+ * Given a dataset opened from a plain CSV file and the text of an "update"
+ * mode, update the column of the selected rows in the model and write the
+ * new values to the file, see `write_update`. Empty cells stay empty. The
+ * table, if the dataset holds one, gets the new values too, and the 
+ * sketches, the kept text and the results cached for the old values are
+ * dropped.
+ * 
+ * args:
+ *  - dataset: the dataset. It must hold the columns the mode reads.
+ *  - user_input: the update mode.
+ *  - in_place: filled with 1 if the file was rewritten in place and 0 if
+ *              it was replaced by a new file.
+ * 
+ * return:
+ *  - the number of updated people, or -1 if the mode is invalid or the file
+ *    could not be updated, in which case the dataset is left as it was.
+ */
+static long dataset_update(people_dataset *dataset, char *user_input, char *in_place) {
+    column_update update;
+    people_model *model = &dataset->model;
+    long updated_count = -1;
+
+    if (dataset->is_sharded || dataset->path == NULL || !parse_update_mode(user_input, &update) ||
+        (get_mode_columns(user_input) & ~model->column_mask)) {
+        return -1;
+    }
+    model_require(model, update.column, 0, model->count);
+    if (!select_update_rows(model, &update) ||
+        !write_update(dataset->path, model, &update,
+                      dataset->has_table ? dataset->table.cell_size[0] : 0, in_place)) {
+        goto after_update;
+    }
+
+    apply_column_update(model, &update);
+    if (dataset->has_table) {
+        update_table_cells(dataset->table, model, &update);
+    }
+    if (dataset->sketches != NULL) {
+        deallocate_sketches(dataset->sketches);
+        free(dataset->sketches);
+        dataset->sketches = NULL;
+    }
+    free(dataset->text);
+    dataset->text = NULL;
+    ++dataset->cache.generation;
+    updated_count = update.selected_count;
+
+after_update:
+    free(update.selected);
+    return updated_count;
+}
+
+/**
+ * Given a path, copy it, for a dataset to open it again later. Without 
+ * memory the copy is NULL and the dataset just cannot open it again.
+ */
+static char *copy_path(const char *path) {
+    unsigned int length = string_length((char *)path);
+    char *copy = malloc(sizeof(char) * (length + 1));
+    if (copy != NULL) {
+        string_simple_copy(copy, (char *)path, length + 1);
+    }
+    return copy;
+}
+
+/**
+ * Given a dataset and the path of an edge list, load the relations between
+ * the people of the dataset, see `build_relation_graph`. They replace the
+ * relations loaded before.
+ * 
+ * args:
+ *  - dataset: the dataset, opened from a single file or buffer with its ids.
+ *  - path: the path of the edge list.
+ *  - skipped_count: filled with the number of lines naming an unknown id.
+ * 
+ * return:
+ *  - the number of loaded lines, or -1 if the relations could not be loaded.
+ */
+static long dataset_load_relations(people_dataset *dataset, char *path, unsigned long *skipped_count) {
+    relation_graph graph;
+    if (dataset->is_sharded || !(dataset->model.column_mask & COLUMN_ID) ||
+        !build_relation_graph(&dataset->model, path, &graph, skipped_count)) {
+        return -1;
+    }
+    if (dataset->relations == NULL) {
+        dataset->relations = malloc(sizeof(relation_graph));
+        if (dataset->relations == NULL) {
+            printf("Allocation fail [19]: could not read the relations.");
+            deallocate_relation_graph(&graph);
+            return -1;
+        }
+    } else {
+        deallocate_relation_graph(dataset->relations);
+    }
+    *dataset->relations = graph;
+    if (dataset->relations_path != path) {
+        free(dataset->relations_path);
+        dataset->relations_path = copy_path(path);
+    }
+    return graph.edge_count / 2;
+}
+
+/**
+ * Given a dataset with relations and the text of a relation mode parsed by
+ * `parse_relation_mode`, run it:
+ *  - "load relations" loads the edge list, see `dataset_load_relations`.
+ *  - "relations" prints the relations of a person.
+ *  - "within" prints the people at most `depth` relations away from a
+ *    person, nearest first.
+ *  - "path" prints the shortest chain of relations between two people.
+ * 
+ * return:
+ *  - returns 1 if the mode was run and 0 if no relations are loaded, the
+ *    dataset does not hold the ids and names or an id does not exist.
+ */
+static char run_relation_mode(
+    people_dataset *dataset,
+    char relation_mode,
+    char *first,
+    char *second,
+    unsigned int depth) {
+
+    people_model *model = &dataset->model;
+    unsigned long skipped_count;
+    unsigned int *distances;
+    unsigned int *parents;
+    unsigned int reached_count;
+
+    if (relation_mode == RELATION_MODE_LOAD) {
+        long line_count = dataset_load_relations(dataset, first, &skipped_count);
+        if (line_count < 0) {
+            return 0;
+        }
+        printf("Loaded %ld relations of %u types", line_count, dataset->relations->relation_types.count);
+        if (skipped_count > 0) {
+            printf(" and skipped %lu lines with unknown ids", skipped_count);
+        }
+        printf("\n");
+        print_times(50, 2, "-");
+        return 1;
+    }
+    relation_graph *graph = dataset->relations;
+    if (graph == NULL || (model->column_mask & (COLUMN_ID | COLUMN_NAME)) != (COLUMN_ID | COLUMN_NAME)) {
+        return 0;
+    }
+    model_require(model, COLUMN_ID | COLUMN_NAME, 0, model->count);
+    int source = model_find_id(model, first);
+    int target = relation_mode == RELATION_MODE_PATH ? model_find_id(model, second) : 0;
+    if (source < 0 || target < 0) {
+        return 0;
+    }
+
+    if (relation_mode == RELATION_MODE_LIST) {
+        for (unsigned long edge = graph->offsets[source]; edge < graph->offsets[source + 1]; ++edge) {
+            unsigned int row = graph->targets[edge];
+            printf("%s: %s (%s)\n", string_dict_get(&graph->relation_types, graph->types[edge]),
+                   string_dict_get(&model->ids, model->id_codes[row]), model_get_name(model, row));
+        }
+        printf("%lu relations of \"%s\"\n", graph->offsets[source + 1] - graph->offsets[source], first);
+        print_times(50, 2, "-");
+        return 1;
+    }
+
+    unsigned int *reached = search_relations(graph, source, relation_mode == RELATION_MODE_WITHIN ?
+        depth : RELATION_UNSEEN - 1, relation_mode == RELATION_MODE_PATH ? target : -1,
+        &distances, &parents, &reached_count);
+    if (reached == NULL) {
+        free(distances);
+        free(parents);
+        return 0;
+    }
+    if (relation_mode == RELATION_MODE_WITHIN) {
+        reached_render render;
+        render.model = model;
+        render.rows = reached + 1;
+        render.distances = distances;
+        print_rendered_rows(reached_count - 1, render_reached_person, &render);
+        printf("%u people within %u relations of \"%s\"\n", reached_count - 1, depth, first);
+    } else if (distances[target] == RELATION_UNSEEN) {
+        printf("No path from \"%s\" to \"%s\"\n", first, second);
+    } else {
+        unsigned int step = distances[target];
+        reached[step] = target;
+        while (step > 0) {
+            reached[step - 1] = parents[reached[step]];
+            --step;
+        }
+        printf("%s (%s)\n", first, model_get_name(model, source));
+        for (step = 1; step <= distances[target]; ++step) {
+            unsigned int row = reached[step];
+            printf("  -%s-> %s (%s)\n", get_relation_name(graph, reached[step - 1], row),
+                   string_dict_get(&model->ids, model->id_codes[row]), model_get_name(model, row));
+        }
+        printf("%u relations from \"%s\" to \"%s\"\n", distances[target], first, second);
+    }
+    print_times(50, 2, "-");
+    free(reached);
+    free(distances);
+    free(parents);
+    return 1;
+}
+
+PEOPLE_API people_dataset *people_open(const char *path, unsigned int flags) {
+    table_scan scan;
+    people_dataset *dataset;
+    if (is_shard_path((char *)path)) {
+        dataset = open_shard_dataset((char *)path);
+        if (dataset != NULL) {
+            dataset->path = copy_path(path);
+        }
+        return dataset;
+    }
+
+    FILE *input_file = fopen(path, "rb");
+    if (!input_file) {
+        return NULL;
+    }
+    char *raw_string = get_string_from_file_stream(input_file, &scan);
+    fclose(input_file);
+    if (raw_string == NULL) {
+        return NULL;
+    }
+    dataset = dataset_from_string(raw_string, scan, flags & PEOPLE_KEEP_TEXT);
+    if (dataset != NULL) {
+        dataset->path = copy_path(path);
+    }
+    return dataset;
+}
+
+PEOPLE_API people_dataset *people_open_columns(const char *path, unsigned int column_mask) {
+    if (is_shard_path((char *)path) || (column_mask & COLUMN_TABLE)) {
+        return people_open(path, 0);
+    }
+
+    FILE *input_file = fopen(path, "rb");
+    if (!input_file) {
+        return NULL;
+    }
+    people_dataset *dataset = calloc(1, sizeof(people_dataset));
+    if (column_mask & COLUMN_SKETCH) {
+        dataset->sketches = malloc(sizeof(people_sketches));
+        sketches_init(dataset->sketches, column_mask);
+    }
+    char success = build_model_projected(input_file, column_mask & COLUMN_ALL, &dataset->model, dataset->sketches);
+    fclose(input_file);
+    if (!success) {
+        if (dataset->sketches != NULL) {
+            deallocate_sketches(dataset->sketches);
+        }
+        free(dataset->sketches);
+        free(dataset);
+        return NULL;
+    }
+    dataset->names.model = &dataset->model;
+    dataset->names.count = dataset->model.count;
+    dataset->path = copy_path(path);
+    dataset->column_mask = column_mask;
+    return dataset;
+}
+
+PEOPLE_API people_dataset *people_open_buffer(const char *text, unsigned long length) {
+    table_scan scan;
+    char *raw_string = malloc(sizeof(char) * (length + 1));
+    if (raw_string == NULL) {
+        printf("Allocation fail [9]: returning NULL.");
+        return NULL;
+    }
+    string_simple_copy(raw_string, (char *)text, length);
+    raw_string[length] = '\0';
+
+    table_scan_init(&scan);
+    table_scan_chunk(&scan, raw_string, length);
+    table_scan_finish(&scan);
+    return dataset_from_string(raw_string, scan, 0);
+}
+
+/**
+ * Given a dataset, free the data it holds: its table, model and shards,
+ * and everything computed from them. The path and the result cache are
+ * kept, and so is the path of the relations, see `people_reload`.
+ */
+static void dataset_release(people_dataset *dataset) {
+    if (dataset->is_sharded) {
+        for (unsigned int i = 0; i < dataset->set.count; ++i) {
+            if (dataset->set.shards[i].loaded) {
+                deallocate_model(&dataset->set.shards[i].model);
+                deallocate_string_mat(dataset->set.shards[i].table);
+            }
+            free(dataset->set.shards[i].path);
+        }
+        free(dataset->set.shards);
+        free(dataset->shard_offsets);
+    } else {
+        deallocate_name_index(&dataset->names);
+        deallocate_model(&dataset->model);
+        if (dataset->has_table) {
+            deallocate_string_mat(dataset->table);
+        }
+    }
+    if (dataset->sketches != NULL) {
+        deallocate_sketches(dataset->sketches);
+        free(dataset->sketches);
+    }
+    if (dataset->relations != NULL) {
+        deallocate_relation_graph(dataset->relations);
+        free(dataset->relations);
+    }
+    free(dataset->sorted_rows);
+    free(dataset->selected_rows);
+    free(dataset->text);
+}
+
+PEOPLE_API void people_close(people_dataset *dataset) {
+    if (dataset == NULL) {
+        return;
+    }
+    dataset_release(dataset);
+    deallocate_result_cache(&dataset->cache);
+    free(dataset->path);
+    free(dataset->relations_path);
+    free(dataset);
+}
+
+PEOPLE_API int people_reload(people_dataset *dataset) {
+    if (dataset->path == NULL) {
+        return 0;
+    }
+    people_dataset *reloaded = dataset->column_mask != 0 ?
+        people_open_columns(dataset->path, dataset->column_mask) : people_open(dataset->path, 0);
+    if (reloaded == NULL) {
+        return 0;
+    }
+    free(reloaded->path);
+    reloaded->path = dataset->path;
+    reloaded->column_mask = dataset->column_mask;
+    reloaded->cache = dataset->cache;
+    ++reloaded->cache.generation;
+    reloaded->relations_path = dataset->relations_path;
+
+    dataset_release(dataset);
+    *dataset = *reloaded;
+    dataset->names.model = &dataset->model;
+    free(reloaded);
+    if (dataset->relations_path != NULL) {
+        unsigned long skipped_count;
+        dataset_load_relations(dataset, dataset->relations_path, &skipped_count);
+    }
+    return 1;
+}
+
+PEOPLE_API long people_update(people_dataset *dataset, const char *update) {
+    char user_input[261];
+    char in_place;
+    snprintf(user_input, sizeof(user_input), "update %s", update);
+    return dataset_update(dataset, user_input, &in_place);
+}
+
+PEOPLE_API long people_load_relations(people_dataset *dataset, const char *path) {
+    unsigned long skipped_count;
+    return dataset_load_relations(dataset, (char *)path, &skipped_count);
+}
+
+PEOPLE_API long people_relations(
+    people_dataset *dataset,
+    unsigned long row,
+    void (*found)(void *context, unsigned long row, const char *relation),
+    void *context) {
+
+    relation_graph *graph = dataset->relations;
+    if (graph == NULL || row >= graph->vertex_count) {
+        return -1;
+    }
+    for (unsigned long edge = graph->offsets[row]; edge < graph->offsets[row + 1]; ++edge) {
+        found(context, graph->targets[edge], string_dict_get(&graph->relation_types, graph->types[edge]));
+    }
+    return graph->offsets[row + 1] - graph->offsets[row];
+}
+
+PEOPLE_API long people_within(
+    people_dataset *dataset,
+    unsigned long row,
+    unsigned int depth,
+    void (*found)(void *context, unsigned long row, unsigned int distance),
+    void *context) {
+
+    unsigned int *distances;
+    unsigned int *parents;
+    unsigned int reached_count;
+    relation_graph *graph = dataset->relations;
+    if (graph == NULL || row >= graph->vertex_count || depth == RELATION_UNSEEN) {
+        return -1;
+    }
+    unsigned int *reached = search_relations(graph, row, depth, -1, &distances, &parents, &reached_count);
+    if (reached != NULL) {
+        for (unsigned int i = 1; i < reached_count; ++i) {
+            found(context, reached[i], distances[reached[i]]);
+        }
+    }
+    free(reached);
+    free(distances);
+    free(parents);
+    return reached != NULL ? (long)reached_count - 1 : -1;
+}
+
+PEOPLE_API long people_shortest_path(
+    people_dataset *dataset,
+    unsigned long from,
+    unsigned long to,
+    void (*found)(void *context, unsigned long row, const char *relation),
+    void *context) {
+
+    unsigned int *distances;
+    unsigned int *parents;
+    unsigned int reached_count;
+    long distance = -1;
+    relation_graph *graph = dataset->relations;
+    if (graph == NULL || from >= graph->vertex_count || to >= graph->vertex_count) {
+        return -1;
+    }
+    unsigned int *reached = search_relations(graph, from, RELATION_UNSEEN - 1, to,
+                                             &distances, &parents, &reached_count);
+    if (reached != NULL && distances[to] != RELATION_UNSEEN) {
+        distance = distances[to];
+        reached[distance] = to;
+        for (long step = distance; step > 0; --step) {
+            reached[step - 1] = parents[reached[step]];
+        }
+        found(context, from, "");
+        for (long step = 1; step <= distance; ++step) {
+            found(context, reached[step], get_relation_name(graph, reached[step - 1], reached[step]));
+        }
+    }
+    free(reached);
+    free(distances);
+    free(parents);
+    return distance;
+}
+
+PEOPLE_API void people_cache_stats(
+    people_dataset *dataset,
+    unsigned long *hits,
+    unsigned long *misses,
+    unsigned int *cached_count) {
+
+    *hits = dataset->cache.hits;
+    *misses = dataset->cache.misses;
+    if (cached_count != NULL) {
+        *cached_count = result_cache_count(&dataset->cache);
+    }
+}
+
+PEOPLE_API unsigned long people_count(people_dataset *dataset) {
+    if (dataset->is_sharded) {
+        return dataset->total.count;
+    }
+    return dataset->model.count;
+}
+
+PEOPLE_API unsigned int people_shard_count(people_dataset *dataset, unsigned int *cached_count) {
+    if (cached_count != NULL) {
+        *cached_count = dataset->cached_count;
+    }
+    return dataset->is_sharded ? dataset->set.count : 0;
+}
+
+PEOPLE_API const char *people_text(people_dataset *dataset) {
+    return dataset->text;
+}
+
+PEOPLE_API void people_release_text(people_dataset *dataset) {
+    free(dataset->text);
+    dataset->text = NULL;
+}
+
+PEOPLE_API int people_aggregate(
+    people_dataset *dataset,
+    unsigned int column,
+    unsigned int operation,
+    double *result) {
+
+    unsigned long count;
+    unsigned long sum;
+    unsigned int smallest;
+    unsigned int largest;
+
+    if (column != COLUMN_AGE && column != COLUMN_WEIGHT) {
+        return 0;
+    }
+    if (dataset->is_sharded) {
+        count = dataset->total.count;
+        sum = column == COLUMN_AGE ? dataset->total.age_sum : dataset->total.weight_sum;
+        smallest = column == COLUMN_AGE ? dataset->total.age_min : dataset->total.weight_min;
+        largest = column == COLUMN_AGE ? dataset->total.age_max : dataset->total.weight_max;
+    } else {
+        people_model *model = &dataset->model;
+        if (!(model->column_mask & column)) {
+            return 0;
+        }
+        if (operation == PEOPLE_MIN || operation == PEOPLE_MAX) {
+            if (!model_zone_range(model, column, &smallest, &largest)) {
+                return 0;
+            }
+            *result = operation == PEOPLE_MIN ? smallest : largest;
+            return 1;
+        }
+        model_require(model, column, 0, model->count);
+        unsigned int *values = column == COLUMN_AGE ? model->ages : model->weights;
+        count = model->count;
+        sum = 0;
+        for (unsigned int i = 0; i < model->count; ++i) {
+            sum += values[i];
+        }
+    }
+    if (count == 0 || (operation != PEOPLE_AVERAGE && smallest > largest)) {
+        return 0;
+    }
+
+    switch (operation) {
+        case PEOPLE_AVERAGE:
+            *result = (double)sum / count;
+            return 1;
+        case PEOPLE_MIN:
+            *result = smallest;
+            return 1;
+        case PEOPLE_MAX:
+            *result = largest;
+            return 1;
+    }
+    return 0;
+}
+
+PEOPLE_API long people_find_id(people_dataset *dataset, const char *id) {
+    if (dataset->is_sharded) {
+        return dataset_find_shard_id(dataset, (char *)id);
+    }
+    if (!(dataset->model.column_mask & COLUMN_ID)) {
+        return -1;
+    }
+    return model_find_id(&dataset->model, (char *)id);
+}
+
+PEOPLE_API int people_get_row(people_dataset *dataset, unsigned long row, people_row *row_out) {
+    people_model *model = dataset_locate_row(dataset, &row);
+    if (model == NULL) {
+        return 0;
+    }
+    model_require(model, model->column_mask, row, 1);
+    row_out->id = model->id_codes ? string_dict_get(&model->ids, model->id_codes[row]) : NULL;
+    row_out->name = model->name_codes ? model_get_name(model, row) : NULL;
+    row_out->age = model->ages ? model->ages[row] : 0;
+    row_out->weight = model->weights ? model->weights[row] : 0;
+    return 1;
+}
+
+/**
+ * Carries the callback of `people_find_name` through the name index searches.
+ */
+typedef struct _find_name_context {
+
+    void (*found)(void *context, unsigned long row);
+    void *context;
+} find_name_context;
+
+/**
+ * A callback of the name index searches that forwards the row to the 
+ * callback of `people_find_name`.
+ */
+static void forward_found_row(void *context_pointer, unsigned int row) {
+    find_name_context *context = context_pointer;
+    context->found(context->context, row);
+}
+
+PEOPLE_API unsigned long people_find_name(
+    people_dataset *dataset,
+    const char *text,
+    int prefix,
+    void (*found)(void *context, unsigned long row),
+    void *context) {
+
+    find_name_context forward = {found, context};
+    if (dataset->is_sharded || !(dataset->model.column_mask & COLUMN_NAME)) {
+        return 0;
+    }
+    model_require(&dataset->model, COLUMN_NAME, 0, dataset->model.count);
+    name_index_build(&dataset->names);
+    if (prefix) {
+        return name_index_find_prefix(&dataset->names, (char *)text, forward_found_row, &forward);
+    }
+    return name_index_find_substring(&dataset->names, (char *)text, forward_found_row, &forward);
+}
+
+PEOPLE_API const unsigned int *people_column_buffer(
+    people_dataset *dataset,
+    unsigned int column,
+    unsigned long *length) {
+
+    people_model *model = &dataset->model;
+    if (dataset->is_sharded || !(model->column_mask & column)) {
+        return NULL;
+    }
+    model_require(model, column, 0, model->count);
+    *length = model->count;
+    switch (column) {
+        case COLUMN_ID:
+            return model->id_codes;
+        case COLUMN_NAME:
+            return model->name_codes;
+        case COLUMN_AGE:
+            return model->ages;
+        case COLUMN_WEIGHT:
+            return model->weights;
+    }
+    return NULL;
+}
+
+PEOPLE_API const char *people_dictionary_buffer(
+    people_dataset *dataset,
+    unsigned int column,
+    const unsigned long **offsets,
+    unsigned int *code_count) {
+
+    people_model *model = &dataset->model;
+    string_dict *dict;
+    if (dataset->is_sharded || !(model->column_mask & column)) {
+        return NULL;
+    }
+    if (column == COLUMN_ID) {
+        dict = &model->ids;
+    } else if (column == COLUMN_NAME) {
+        dict = &model->names;
+    } else {
+        return NULL;
+    }
+    model_require(model, column, 0, model->count);
+    *offsets = dict->offsets;
+    *code_count = dict->count;
+    return dict->pool;
+}
+
+PEOPLE_API const unsigned int *people_sort(people_dataset *dataset, unsigned int column, int descending) {
+    if (dataset->is_sharded) {
+        return NULL;
+    }
+    free(dataset->sorted_rows);
+    dataset->sorted_rows = sort_model_rows(&dataset->model, column, descending != 0);
+    return dataset->sorted_rows;
+}
+
+PEOPLE_API people_dataset *people_join(people_dataset *dataset, const char *path) {
+    string_mat other;
+    if (!dataset->has_table || !read_table_file((char *)path, &other)) {
+        return NULL;
+    }
+    people_dataset *joined = calloc(1, sizeof(people_dataset));
+    if (joined == NULL) {
+        printf("Allocation fail [9]: returning NULL.");
+        deallocate_string_mat(other);
+        return NULL;
+    }
+    join_result join = join_tables(dataset->table, 0, other, 0);
+    joined->table = build_joined_table(dataset->table, other, 0, join);
+    dataset_init_table(joined);
+    deallocate_join_result(join);
+    deallocate_string_mat(other);
+    return joined;
+}
+
+PEOPLE_API const unsigned int *people_select(
+    people_dataset *dataset,
+    const char *predicate,
+    unsigned long *count) {
+
+    row_filter filter;
+    unsigned int selected_count;
+    if (dataset->is_sharded || !parse_filter((char *)predicate, &filter) ||
+        (filter.column_mask & ~dataset->model.column_mask)) {
+        return NULL;
+    }
+    free(dataset->selected_rows);
+    dataset->selected_rows = filter_model_rows(&dataset->model, &filter, &selected_count);
+    *count = selected_count;
+    return dataset->selected_rows;
+}
+
+PEOPLE_API int people_export_arrow(people_dataset *dataset, const char *path) {
+    unsigned int batch_count;
+    if (dataset->is_sharded || (dataset->model.column_mask & COLUMN_ALL) != COLUMN_ALL) {
+        return 0;
+    }
+    return export_model_arrow(&dataset->model, dataset->has_table ? &dataset->table : NULL,
+                              NULL, 0, (char *)path, &batch_count);
+}
+
+PEOPLE_API unsigned int people_mode_columns(const char *mode) {
+    return get_mode_columns((char *)mode);
+}
+
+PEOPLE_API double people_distinct(people_dataset *dataset, unsigned int column, double *relative_error) {
+    unsigned int column_index = column == COLUMN_ID ? 0 : column == COLUMN_NAME ? 1 : column == COLUMN_AGE ? 2 : 3;
+    if (column != COLUMN_ID && column != COLUMN_NAME && column != COLUMN_AGE && column != COLUMN_WEIGHT) {
+        return -1;
+    }
+    people_sketches *sketches = dataset_sketches(dataset, column);
+    if (sketches == NULL) {
+        return -1;
+    }
+    if (relative_error != NULL) {
+        *relative_error = 2 * HLL_ERROR;
+    }
+    return hll_estimate(&sketches->distinct[column_index]);
+}
+
+PEOPLE_API int people_quantile(
+    people_dataset *dataset,
+    unsigned int column,
+    double fraction,
+    unsigned int *result,
+    double *rank_error) {
+
+    if ((column != COLUMN_AGE && column != COLUMN_WEIGHT) || fraction < 0 || fraction > 1) {
+        return 0;
+    }
+    people_sketches *sketches = dataset_sketches(dataset, column);
+    if (sketches == NULL || sketches->count == 0) {
+        return 0;
+    }
+    kll_sketch *sketch = column == COLUMN_AGE ? &sketches->ages : &sketches->weights;
+    *result = kll_quantile(sketch, fraction);
+    if (rank_error != NULL) {
+        *rank_error = sketch->compacted ? KLL_RANK_ERROR : 0;
+    }
+    return 1;
+}
+
+PEOPLE_API int people_run_mode(people_dataset *dataset, const char *mode) {
+    char *user_input = (char *)mode;
+    char first[261];
+    char second[261];
+    unsigned int depth = 0;
+    char relation_mode;
+    unsigned char column;
+    int percentile;
+    if (parse_sketch_mode(user_input, &column, &percentile)) {
+        return print_sketch_mode(user_input, dataset_sketches(dataset, column));
+    }
+    if (string_compare(user_input, "reload")) {
+        if (!people_reload(dataset)) {
+            return 0;
+        }
+        printf("Reloaded %lu people\n", people_count(dataset));
+        print_times(50, 2, "-");
+        return 1;
+    }
+    if (string_starts_with(user_input, "update ")) {
+        char in_place;
+        long updated_count = dataset_update(dataset, user_input, &in_place);
+        if (updated_count < 0) {
+            return 0;
+        }
+        printf("Updated %ld people and %s \"%s\"\n", updated_count,
+               in_place ? "rewrote their cells in" : "wrote a new", dataset->path);
+        print_times(50, 2, "-");
+        return 1;
+    }
+    relation_mode = parse_relation_mode(user_input, first, second, &depth);
+    if (relation_mode != RELATION_MODE_NONE) {
+        return run_relation_mode(dataset, relation_mode, first, second, depth);
+    }
+    if (string_compare(user_input, "cache stats")) {
+        printf("%lu hits and %lu misses, %u results cached\n", dataset->cache.hits,
+               dataset->cache.misses, result_cache_count(&dataset->cache));
+        print_times(50, 2, "-");
+        return 1;
+    }
+    if (dataset->is_sharded) {
+        return run_shard_mode(dataset, user_input);
+    }
+    return run_mode(user_input, &dataset->model,
+                    dataset->has_table ? &dataset->table : NULL, &dataset->names, &dataset->cache);
+}
@@ -0,0 +1,466 @@
+#ifndef PEOPLE_H
+#define PEOPLE_H
+
+/**
+ * The public interface of libpeople, the engine behind app2.c.
+ *
+ * A dataset is opened from a CSV file of people (id, name, age and weight),
+ * a gzip or zstd compressed CSV file, a directory or a glob pattern of
+ * CSV shard files, or a buffer in memory. It is only used through the
+ * opaque people_dataset handle so its layout can change without breaking
+ * programs built against this header.
+ *
+ * Building the library and the command line program:
+ *
+ *   gcc -O2 -fPIC -shared -fvisibility=hidden -pthread -o libpeople.so people.c -lm
+ *   gcc -O2 -o app2 app2.c -L. -lpeople -Wl,-rpath,'$ORIGIN'
+ *
+ * Add -DHAVE_ZLIB -lz and -DHAVE_ZSTD -lzstd to the first command to read
+ * gzip and zstd files.
+ *
+ * On Linux, plain files are read with io_uring when the kernel allows it.
+ * Set the environment variable PEOPLE_DIRECT_IO to 1 to read them with
+ * O_DIRECT, so a one-off scan does not fill the page cache.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define PEOPLE_API __attribute__((visibility("default")))
+#else
+#define PEOPLE_API
+#endif
+
+/**
+ * The columns of a dataset. They can be combined into a column mask.
+ */
+#define PEOPLE_COLUMN_ID 1
+#define PEOPLE_COLUMN_NAME 2
+#define PEOPLE_COLUMN_AGE 4
+#define PEOPLE_COLUMN_WEIGHT 8
+#define PEOPLE_COLUMN_ALL 15
+
+/**
+ * Returned by `people_mode_columns` with the other columns for the modes
+ * that print the table of the file. `people_open_columns` then opens the
+ * whole file as `people_open` does.
+ */
+#define PEOPLE_COLUMN_TABLE 16
+
+/**
+ * Returned by `people_mode_columns` with the column of the sketch modes.
+ * `people_open_columns` then sketches the column in one pass while parsing,
+ * without keeping the rows: the dataset only answers the sketch modes,
+ * `people_count`, `people_distinct` and `people_quantile`.
+ */
+#define PEOPLE_COLUMN_SKETCH 32
+
+/**
+ * The aggregates computed by `people_aggregate`.
+ */
+#define PEOPLE_AVERAGE 0
+#define PEOPLE_MIN 1
+#define PEOPLE_MAX 2
+
+/**
+ * The flags of `people_open`.
+ * PEOPLE_KEEP_TEXT keeps the text of the file for `people_text`.
+ */
+#define PEOPLE_KEEP_TEXT 1
+
+typedef struct _people_dataset people_dataset;
+
+/**
+ * One person of a dataset as returned by `people_get_row`.
+ * The strings belong to the dataset.
+*/
+typedef struct _people_row {
+
+    const char *id;
+    const char *name;
+    unsigned int age;
+    unsigned int weight;
+} people_row;
+
+/**
+ * Given a path, open the dataset it names. Rows are decoded lazily, the
+ * first time they are used.
+ *
+ * args:
+ *  - path: a CSV file (plain, gzip or zstd), a directory or a glob pattern.
+ *  - flags: 0 or PEOPLE_KEEP_TEXT.
+ *
+ * return:
+ *  - the dataset, or NULL if it could not be read or is corrupt.
+ */
+PEOPLE_API people_dataset *people_open(const char *path, unsigned int flags);
+
+/**
+ * Given the path of a CSV file and a column mask, open a dataset that only
+ * holds the columns of the mask. The other fields are skipped while parsing.
+ *
+ * return:
+ *  - the dataset, or NULL if it could not be read or is corrupt.
+ */
+PEOPLE_API people_dataset *people_open_columns(const char *path, unsigned int column_mask);
+
+/**
+ * Given a buffer of CSV text and its length, open a dataset over a copy of it.
+ *
+ * return:
+ *  - the dataset, or NULL if the text is corrupt.
+ */
+PEOPLE_API people_dataset *people_open_buffer(const char *text, unsigned long length);
+
+/**
+ * Close a dataset and free all of its memory, including the buffers and
+ * strings returned for it.
+ */
+PEOPLE_API void people_close(people_dataset *dataset);
+
+/**
+ * return:
+ *  - the number of people in the dataset.
+ */
+PEOPLE_API unsigned long people_count(people_dataset *dataset);
+
+/**
+ * Given a dataset, find how many shard files it was opened from.
+ *
+ * args:
+ *  - cached_count: if not NULL, filled with the number of shards whose
+ *                  aggregates came from the shard cache.
+ *
+ * return:
+ *  - the number of shards, or 0 if the dataset is a single file or buffer.
+ */
+PEOPLE_API unsigned int people_shard_count(people_dataset *dataset, unsigned int *cached_count);
+
+/**
+ * return:
+ *  - the text of the file if the dataset was opened with PEOPLE_KEEP_TEXT,
+ *    or NULL.
+ */
+PEOPLE_API const char *people_text(people_dataset *dataset);
+
+/**
+ * Free the text kept by PEOPLE_KEEP_TEXT once it is no longer needed.
+ */
+PEOPLE_API void people_release_text(people_dataset *dataset);
+
+/**
+ * Given a dataset, a numeric column and an aggregate, compute the aggregate.
+ * Empty cells count as 0 in the average and are left out of the minimum
+ * and maximum.
+ *
+ * args:
+ *  - column: PEOPLE_COLUMN_AGE or PEOPLE_COLUMN_WEIGHT.
+ *  - operation: PEOPLE_AVERAGE, PEOPLE_MIN or PEOPLE_MAX.
+ *  - result: filled with the aggregate.
+ *
+ * return:
+ *  - 1 on success and 0 if the column is not numeric, not loaded or empty,
+ *    or if every cell is empty for a minimum or maximum.
+ */
+PEOPLE_API int people_aggregate(
+    people_dataset *dataset,
+    unsigned int column,
+    unsigned int operation,
+    double *result);
+
+/**
+ * return:
+ *  - the row of the person with the id, or -1 if there is none.
+ */
+PEOPLE_API long people_find_id(people_dataset *dataset, const char *id);
+
+/**
+ * Given a dataset and a row, fill `row_out` with the person of the row.
+ *
+ * return:
+ *  - 1 on success and 0 if the row does not exist.
+ */
+PEOPLE_API int people_get_row(people_dataset *dataset, unsigned long row, people_row *row_out);
+
+/**
+ * Given a dataset and a text, call `found(context, row)` for every row whose
+ * name contains the text or, if `prefix` is not 0, starts with it.
+ * Case is ignored.
+ *
+ * return:
+ *  - the number of matching rows.
+ */
+PEOPLE_API unsigned long people_find_name(
+    people_dataset *dataset,
+    const char *text,
+    int prefix,
+    void (*found)(void *context, unsigned long row),
+    void *context);
+
+/**
+ * Given a dataset and a column, return the column's buffer without copying.
+ *
+ * For PEOPLE_COLUMN_AGE and PEOPLE_COLUMN_WEIGHT the buffer holds the values.
+ * For PEOPLE_COLUMN_ID and PEOPLE_COLUMN_NAME it holds the dictionary code
+ * of each row. See `people_dictionary_buffer`.
+ * The buffer is valid until the dataset is closed.
+ *
+ * args:
+ *  - length: filled with the number of values in the buffer.
+ *
+ * return:
+ *  - the buffer, or NULL if the dataset has no contiguous buffer for the column.
+ */
+PEOPLE_API const unsigned int *people_column_buffer(
+    people_dataset *dataset,
+    unsigned int column,
+    unsigned long *length);
+
+/**
+ * Given a dataset and a string column, return its dictionary without copying:
+ * the null terminated strings of every code, one after the other, and the
+ * offset of the string of each code in that buffer.
+ *
+ * args:
+ *  - column: PEOPLE_COLUMN_ID or PEOPLE_COLUMN_NAME.
+ *  - offsets: filled with the offset of the string of each code.
+ *  - code_count: filled with the number of codes.
+ *
+ * return:
+ *  - the string buffer, or NULL if the dataset has no dictionary for the column.
+ */
+PEOPLE_API const char *people_dictionary_buffer(
+    people_dataset *dataset,
+    unsigned int column,
+    const unsigned long **offsets,
+    unsigned int *code_count);
+
+/**
+ * Given a dataset and a column, sort the rows of the dataset by the column.
+ * Rows with equal values keep the order of the file. Ids and names are
+ * ordered by their bytes.
+ *
+ * args:
+ *  - column: PEOPLE_COLUMN_ID, PEOPLE_COLUMN_NAME, PEOPLE_COLUMN_AGE or PEOPLE_COLUMN_WEIGHT.
+ *  - descending: 0 for ascending and 1 for descending order.
+ *
+ * return:
+ *  - the `people_count` rows in sorted order, valid until the next sort
+ *    or until the dataset is closed, or NULL if the column is not loaded.
+ */
+PEOPLE_API const unsigned int *people_sort(people_dataset *dataset, unsigned int column, int descending);
+
+/**
+ * Given a dataset and the path of another CSV file whose first column is an
+ * id, join them by id into a new dataset: one row for every pair of rows
+ * with the same id, with the columns of the dataset and then the other
+ * columns of the file. The new dataset must be closed on its own.
+ *
+ * return:
+ *  - the joined dataset, or NULL if the other file could not be read or
+ *    the dataset was not opened with `people_open` from a single file.
+ */
+PEOPLE_API people_dataset *people_join(people_dataset *dataset, const char *path);
+
+/**
+ * Given a dataset and a column, estimate the number of distinct values in
+ * the column with a HyperLogLog sketch. Sketches are merged across shards.
+ *
+ * args:
+ *  - relative_error: if not NULL, filled with the relative error of the
+ *                    estimate at 95% confidence.
+ *
+ * return:
+ *  - the estimate, or -1 if the dataset does not hold the column.
+ */
+PEOPLE_API double people_distinct(people_dataset *dataset, unsigned int column, double *relative_error);
+
+/**
+ * Given a dataset, a numeric column and a fraction, find the quantile of
+ * the column with a KLL sketch: the smallest value with at least `fraction`
+ * of the values at or below it.
+ *
+ * args:
+ *  - column: PEOPLE_COLUMN_AGE or PEOPLE_COLUMN_WEIGHT.
+ *  - fraction: between 0 and 1, 0.95 for the 95th percentile.
+ *  - result: filled with the quantile.
+ *  - rank_error: if not NULL, filled with the error of the rank of the
+ *                quantile, as a fraction of the values, at 99% confidence.
+ *                It is 0 when the quantile is exact.
+ *
+ * return:
+ *  - 1 on success and 0 if the column is not numeric, not held or empty.
+ */
+PEOPLE_API int people_quantile(
+    people_dataset *dataset,
+    unsigned int column,
+    double fraction,
+    unsigned int *result,
+    double *rank_error);
+
+/**
+ * Given a dataset and a path, write the people of the dataset to a file in
+ * the Arrow IPC file format: a utf8 column for id and name and a uint32
+ * column for age and weight, where empty cells are null, in record batches
+ * of 65536 rows. The file can be mapped with any Arrow library.
+ *
+ * return:
+ *  - 1 on success and 0 if the file could not be written or the dataset is
+ *    sharded or does not hold every column.
+ */
+PEOPLE_API int people_export_arrow(people_dataset *dataset, const char *path);
+
+/**
+ * Given a dataset and a predicate such as "age > 40 and weight < 70", find
+ * the rows that pass it. A predicate compares age or weight with a number
+ * using <, <=, >, >=, = or !=, and joins comparisons with "and" and "or",
+ * where "and" binds tighter.
+ *
+ * args:
+ *  - count: filled with the number of passing rows.
+ *
+ * return:
+ *  - the passing rows in the order of the file, valid until the next
+ *    selection or until the dataset is closed, or NULL if the predicate
+ *    is invalid, reads a column that is not loaded or the dataset is sharded.
+ */
+PEOPLE_API const unsigned int *people_select(
+    people_dataset *dataset,
+    const char *predicate,
+    unsigned long *count);
+
+/**
+ * Given a dataset, read it again from the path it was opened from, the same
+ * way it was opened, after the files changed. Results cached by
+ * `people_run_mode` for the old data are no longer used. Rows, buffers and
+ * strings returned for the dataset before the reload are freed.
+ *
+ * return:
+ *  - 1 on success and 0 if the dataset was opened from a buffer or could
+ *    not be read again, in which case it is left as it was.
+ */
+PEOPLE_API int people_reload(people_dataset *dataset);
+
+/**
+ * Given a dataset opened from a plain CSV file and an update such as
+ * "age += 1", "weight -= 2 where age > 40" or "weight = 70 where id in
+ * ids.txt", change the column of the selected rows and write the new values
+ * to the file. The operation is +=, -= or = and the clause is a predicate
+ * of `people_select` or "id in" and the path of a file with one id per
+ * line. Empty cells are left empty.
+ *
+ * If the new values have as many digits as the old ones only their cells
+ * are rewritten. Otherwise a new file replaces the old one.
+ *
+ * return:
+ *  - the number of updated people, or -1 if the update is invalid, takes a
+ *    value below 0, or the file could not be written, in which case
+ *    neither the dataset nor the file changed.
+ */
+PEOPLE_API long people_update(people_dataset *dataset, const char *update);
+
+/**
+ * Given a dataset opened from a single file or buffer and the path of an
+ * edge list, a CSV file of "id,id,relation" lines, load the relations 
+ * between the people of the dataset. The relation of the second person to
+ * the first is a fourth field, or the same relation if it is missing. The
+ * first line is a header, and skipped, only if one of its first two fields
+ * is not an id of the dataset. Other lines that name an unknown id are
+ * skipped. The relations replace the ones loaded before and are loaded
+ * again by `people_reload`.
+ *
+ * return:
+ *  - the number of loaded lines, or -1 if the file could not be read or is
+ *    corrupt or the dataset does not hold the ids.
+ */
+PEOPLE_API long people_load_relations(people_dataset *dataset, const char *path);
+
+/**
+ * Given a dataset with relations and a row, call `found(context, other,
+ * relation)` for every relation of the row: the other row is the row's
+ * `relation`, in the order of the edge list.
+ *
+ * return:
+ *  - the number of relations, or -1 if no relations are loaded or the row
+ *    does not exist.
+ */
+PEOPLE_API long people_relations(
+    people_dataset *dataset,
+    unsigned long row,
+    void (*found)(void *context, unsigned long row, const char *relation),
+    void *context);
+
+/**
+ * Given a dataset with relations, a row and a depth, call `found(context,
+ * other, distance)` for every other row at most `depth` relations away,
+ * nearest first and then in the order of the rows. The search expands the
+ * rows of each distance in parallel.
+ *
+ * return:
+ *  - the number of rows found, or -1 if no relations are loaded or the row
+ *    does not exist.
+ */
+PEOPLE_API long people_within(
+    people_dataset *dataset,
+    unsigned long row,
+    unsigned int depth,
+    void (*found)(void *context, unsigned long row, unsigned int distance),
+    void *context);
+
+/**
+ * Given a dataset with relations and two rows, find a shortest chain of
+ * relations from the first to the second and call `found(context, row,
+ * relation)` for every row of the chain in order, with the relation of the
+ * row before it to it, or "" for the first row. The chain is the same on
+ * every call.
+ *
+ * return:
+ *  - the number of relations of the chain, or -1 if there is none, no
+ *    relations are loaded or a row does not exist.
+ */
+PEOPLE_API long people_shortest_path(
+    people_dataset *dataset,
+    unsigned long from,
+    unsigned long to,
+    void (*found)(void *context, unsigned long row, const char *relation),
+    void *context);
+
+/**
+ * Given a dataset, find how well `people_run_mode` used its result cache,
+ * which keeps the results of the aggregate and count modes and of id
+ * lookups until the dataset is reloaded.
+ *
+ * args:
+ *  - hits: filled with the number of modes answered from the cache.
+ *  - misses: filled with the number of modes whose results were not cached.
+ *  - cached_count: if not NULL, filled with the number of results cached
+ *                  for the current data.
+ */
+PEOPLE_API void people_cache_stats(
+    people_dataset *dataset,
+    unsigned long *hits,
+    unsigned long *misses,
+    unsigned int *cached_count);
+
+/**
+ * Given the text of a mode of the command line program, find the columns
+ * it needs, for `people_open_columns`.
+ */
+PEOPLE_API unsigned int people_mode_columns(const char *mode);
+
+/**
+ * Given a dataset and the text of a mode of the command line program, run
+ * the mode and print its output to the standard output.
+ *
+ * return:
+ *  - 1 if the mode was run and 0 if it is invalid or names an unknown id.
+ */
+PEOPLE_API int people_run_mode(people_dataset *dataset, const char *mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,12 +1,23 @@
-from sys import argv
-from os import listdir
+from sys import argv, stdout
+from os import listdir, environ, path
 from typing import Any, Callable
+from ctypes import CDLL, POINTER, Structure, byref, c_char_p, c_double, c_int, c_long, c_uint, c_ulong, c_void_p
 
 
 # The expected file name of the data file.
 # If no argument is given, the program will search for this name in the working directory.
 DATA_FILE_NAME = "Data.csv"
 
+# The path to libpeople, the C engine of app2.c. It can be overridden with the PEOPLE_LIBRARY environment variable.
+# If the library can not be loaded, the program falls back to the pure Python implementation below.
+LIBRARY_PATH = environ.get("PEOPLE_LIBRARY",
+                           path.join(path.dirname(path.abspath(__file__)), "..", "C", "libpeople.so"))
+
+# The columns and aggregates of libpeople, as defined in people.h.
+PEOPLE_COLUMNS = {"id": 1, "name": 2, "age": 4, "weight": 8}
+PEOPLE_AVERAGE, PEOPLE_MIN, PEOPLE_MAX = 0, 1, 2
+PEOPLE_KEEP_TEXT = 1
+
 
 class Person:
     """
@@ -105,6 +116,188 @@ class Person:
         return f"Person(\tid={self.id},\n\tname={self.name},\n\tage={self.age},\n\tweight={self.weight}\n)"
 
 
+class PeopleRow(Structure):
+    """The people_row struct of people.h, one person as returned by `people_get_row`.
+    """
+    _fields_ = [("id", c_char_p), ("name", c_char_p), ("age", c_uint), ("weight", c_uint)]
+
+
+class PeopleDataset:
+    """
+    A dataset opened through libpeople, the shared library built from C/people.c.
+    The rows stay in the library and are only converted to Person objects when they are asked for.
+
+    Attributes:
+        - library: CDLL
+        - handle: c_void_p
+
+    Class-wide methods:
+        - load_library
+
+    Methods:
+        - close
+        - text
+        - count
+        - aggregate
+        - find_id
+        - person
+        - column
+        - run_mode
+
+    """
+
+    library: "CDLL | None" = None
+
+    @classmethod
+    def load_library(cls, library_path: "str" = LIBRARY_PATH) -> "CDLL | None":
+        """Given the path to libpeople, load it once and declare the types of the functions used.
+
+        Args:
+            library_path (str, optional): the path to the shared library. Defaults to LIBRARY_PATH.
+
+        Returns:
+            CDLL | None: the library, or None if it could not be loaded.
+        """
+        if cls.library is not None:
+            return cls.library
+        try:
+            library = CDLL(library_path)
+        except OSError:
+            return None
+
+        library.people_open.argtypes = [c_char_p, c_uint]
+        library.people_open.restype = c_void_p
+        library.people_close.argtypes = [c_void_p]
+        library.people_close.restype = None
+        library.people_count.argtypes = [c_void_p]
+        library.people_count.restype = c_ulong
+        library.people_text.argtypes = [c_void_p]
+        library.people_text.restype = c_char_p
+        library.people_release_text.argtypes = [c_void_p]
+        library.people_release_text.restype = None
+        library.people_aggregate.argtypes = [c_void_p, c_uint, c_uint, POINTER(c_double)]
+        library.people_aggregate.restype = c_int
+        library.people_find_id.argtypes = [c_void_p, c_char_p]
+        library.people_find_id.restype = c_long
+        library.people_get_row.argtypes = [c_void_p, c_ulong, POINTER(PeopleRow)]
+        library.people_get_row.restype = c_int
+        library.people_column_buffer.argtypes = [c_void_p, c_uint, POINTER(c_ulong)]
+        library.people_column_buffer.restype = c_void_p
+        library.people_run_mode.argtypes = [c_void_p, c_char_p]
+        library.people_run_mode.restype = c_int
+        library.fflush.argtypes = [c_void_p]
+        library.fflush.restype = c_int
+        cls.library = library
+        return library
+
+    def __init__(self, file_path: "str", keep_text: "bool" = False):
+        """Given a file path, open it through libpeople. A OSError is raised if the library is not loaded and a ValueError if the file can not be opened or is corrupt.
+
+        Args:
+            file_path (str): a CSV file, a gzip file, a directory or a glob pattern of shard files.
+            keep_text (bool, optional): keep the text of the file for `text`. Defaults to False.
+        """
+        self.library = PeopleDataset.load_library()
+        if self.library is None:
+            raise OSError(f"libpeople could not be loaded from {LIBRARY_PATH}")
+        self.handle = self.library.people_open(file_path.encode(), PEOPLE_KEEP_TEXT if keep_text else 0)
+        if not self.handle:
+            raise ValueError(f"{file_path} could not be opened")
+
+    def close(self):
+        """Close the dataset and free its memory in the library. Buffers returned by `column` must not be used afterwards.
+        """
+        if self.handle:
+            self.library.people_close(self.handle)
+            self.handle = None
+
+    def text(self) -> "str":
+        """Return the text of the file and free it in the library. Only available once, if the dataset was opened with keep_text.
+
+        Returns:
+            str: the text of the file, or an empty string.
+        """
+        raw_bytes = self.library.people_text(self.handle)
+        self.library.people_release_text(self.handle)
+        return raw_bytes.decode() if raw_bytes else ""
+
+    def count(self) -> "int":
+        """Returns:
+            int: the number of people in the dataset.
+        """
+        return self.library.people_count(self.handle)
+
+    def aggregate(self, attr: "str", operation: "int") -> "float":
+        """Given a numeric attribute and an aggregate, compute the aggregate in the library. A ValueError is raised if the attribute is not numeric.
+
+        Args:
+            attr (str): "age" or "weight".
+            operation (int): PEOPLE_AVERAGE, PEOPLE_MIN or PEOPLE_MAX.
+
+        Returns:
+            float: the value of the aggregate.
+        """
+        result = c_double()
+        if not self.library.people_aggregate(self.handle, PEOPLE_COLUMNS.get(attr, 0), operation, byref(result)):
+            raise ValueError(f"{attr} is not a numeric attribute")
+        return result.value
+
+    def find_id(self, id: "str") -> "int":
+        """Given an id, find the row of the first person with it.
+
+        Args:
+            id (str): the id to be searched.
+
+        Returns:
+            int: the row of the person, or -1 if the id is not found.
+        """
+        return self.library.people_find_id(self.handle, id.encode())
+
+    def person(self, row: "int") -> "Person":
+        """Given a row, build a Person object from it. A IndexError is raised if the row does not exist.
+
+        Args:
+            row (int): a row between 0 and `count()`.
+
+        Returns:
+            Person: the person of the row.
+        """
+        person_row = PeopleRow()
+        if not self.library.people_get_row(self.handle, row, byref(person_row)):
+            raise IndexError(row)
+        return Person(person_row.id.decode(), person_row.name.decode(), person_row.age, person_row.weight)
+
+    def column(self, attr: "str") -> "Any":
+        """Given an attribute, return its column as a ctypes array over the memory of the library, without copying it.
+        Ages and weights hold the values, ids and names hold dictionary codes.
+
+        Args:
+            attr (str): "id", "name", "age" or "weight".
+
+        Returns:
+            Any: a c_uint array of `count()` values, valid until the dataset is closed, or None.
+        """
+        length = c_ulong()
+        address = self.library.people_column_buffer(self.handle, PEOPLE_COLUMNS.get(attr, 0), byref(length))
+        if not address:
+            return None
+        return (c_uint * length.value).from_address(address)
+
+    def run_mode(self, mode: "str") -> "bool":
+        """Given a mode of app2.c, run it in the library. Both the Python and the C output buffers are flushed so the output stays in order.
+
+        Args:
+            mode (str): the mode, for example "table".
+
+        Returns:
+            bool: True if the mode was run.
+        """
+        stdout.flush()
+        success = self.library.people_run_mode(self.handle, mode.encode())
+        self.library.fflush(None)
+        return bool(success)
+
+
 def read_file(path: "str") -> "str":
     """Given a file path, open the file in read mode and dump return its contents as a string.
     If the file is not found, a error message is printed and the exit function is called with exit code 1. The file is closed before return.
@@ -341,6 +534,86 @@ def __exit_p(code: "int", message: "str" = ""):
     exit(code)
 
 
+def run_with_library(file_path: "str"):
+    """Given a file path, run the same steps as `main` through libpeople instead of Python lists.
+
+    The file is parsed, aggregated and searched in the library, and Person objects are only built for the people that are printed.
+
+    Args:
+        file_path (str): the path to the data file, a directory or a glob pattern of shard files.
+    """
+    try:
+        dataset = PeopleDataset(file_path, keep_text=True)
+    except ValueError:
+        __exit_p(1, "No such file found or the CSV file is corrupt.")
+
+    raw_string: "str" = dataset.text()
+    if raw_string:
+        print(raw_string)
+        print_times(50, 2)
+    if dataset.count() == 0:
+        __exit_p(1, "The CSV file is corrupt.")
+
+    attr = "age"
+    print(
+        f"""\
+The average {attr} is {dataset.aggregate(attr, PEOPLE_AVERAGE)}
+The minimum {attr} is {dataset.aggregate(attr, PEOPLE_MIN)}
+The maximum {attr} is {dataset.aggregate(attr, PEOPLE_MAX)}
+""")
+    print_times(50, 2)
+
+    print("""Type "table" to show data""")
+    print("""or "average" before an attribute to show the average""")
+    print("""or "min" before an attribute to show the minimum""")
+    print("""or "max" before an attribute to show the maximum""")
+    print("""or "model" to print all person objects""")
+    print("""or the id of a person object to print it""")
+    print("""or "exit" to quit the program.""", end="\n\n")
+
+    mode: "list[str]" = input("mode> ").strip().split(" ")
+    print()
+
+    if (mode[0] == "exit" and len(mode) == 1):
+        dataset.close()
+        __exit_p(0)
+
+    elif ("table" in mode and len(mode) == 1):
+        if not dataset.run_mode("table"):
+            __exit_p(1, "The table is not available for shards.")
+
+    elif ("model" in mode and len(mode) == 1):
+        for row in range(dataset.count()):
+            print(dataset.person(row))
+        print_times(50, 2)
+
+    elif (mode[0] in ["average", "min", "max"] and len(mode) == 2):
+        if not (mode[1] in PEOPLE_COLUMNS):
+            __exit_p(1, f"""The attribute "{mode[1]}" could not be found""")
+        try:
+            if mode[0] == "average":
+                print(f"""The average {mode[1]} is {dataset.aggregate(mode[1], PEOPLE_AVERAGE)}""")
+            elif mode[0] == "min":
+                print(f"""The minimum {mode[1]} is {format(dataset.aggregate(mode[1], PEOPLE_MIN), "0.2f")}""")
+            else:
+                print(f"""The maximum {mode[1]} is {format(dataset.aggregate(mode[1], PEOPLE_MAX), "0.2f")}""")
+                print_times(50, 2)
+        except ValueError:
+            __exit_p(1, f"""The attribute "{mode[1]}" is not a number""")
+
+    elif (len(mode) == 1 and mode[0].isnumeric()):
+        row = dataset.find_id(mode[0])
+        if row < 0:
+            __exit_p(1, "The provided id not present in the group.")
+        print(dataset.person(row))
+        print()
+
+    else:
+        __exit_p(1, "Invalid input: exiting program.")
+
+    dataset.close()
+
+
 def main():
     """The first function to be called if the module is executed directly.
 
@@ -355,6 +628,8 @@ def main():
         6- print the ages to the console.
         7- wait for user input to examine other options.
         
+    If libpeople can be loaded, the steps are run through it instead. See `run_with_library`.
+
     Args:
         - the path to the data file.
     """
@@ -368,6 +643,10 @@ def main():
         else:
             file_path = DATA_FILE_NAME
 
+    if PeopleDataset.load_library() is not None:
+        run_with_library(file_path)
+        return
+
     raw_string: "str" = read_file(file_path)
     print(raw_string)
     print_times(50, 2)